@@ -30,48 +30,70 @@
 inline double floorfrac (const double value) {return value - floor (value);}
 inline double floormod (const double numer, const double denom) {return numer - floor(numer / denom) * denom;}
 
-BJumblr::BJumblr (double samplerate, const LV2_Feature* const* features) :
+/*
+ * Returns the number of frames (1..max) a linearly changing value stays on
+ * the same side of a threshold.
+ */
+inline int framesBeforeCrossing (const double value, const double increment, const double threshold, const int max)
+{
+	double frames = max;
+	if ((increment > 0.0) && (value < threshold)) frames = ceil ((threshold - value) / increment);
+	else if ((increment < 0.0) && (value >= threshold)) frames = floor ((value - threshold) / -increment) + 1.0;
+	return (frames < 1.0 ? 1 : (frames < max ? int (frames) : max));
+}
+
+/*
+ * Returns the upper limit of the size of a notification object with n
+ * scalar (up to 64 bit) properties and an optional vector or string
+ * property of dataSize bytes.
+ */
+inline uint32_t notifyObjectSize (const int n, const uint32_t dataSize = 0)
+{
+	return	sizeof (LV2_Atom_Object) +
+		n * (sizeof (LV2_Atom_Property_Body) + sizeof (int64_t)) +
+		(dataSize ? sizeof (LV2_Atom_Property_Body) + sizeof (LV2_Atom_Vector_Body) + lv2_atom_pad_size (dataSize) : 0);
+}
+
+BJumblr::BJumblr (double samplerate, const int channels, const LV2_Feature* const* features) :
 	map (NULL), unmap (NULL), workerSchedule (NULL),
 	controlPort (nullptr), notifyPort (nullptr),
-	audioInput1 (nullptr), audioInput2 (nullptr),
-	audioOutput1 (nullptr), audioOutput2 (nullptr),
-	notifyForge (), notifyFrame (),
-	waveform {0.0f}, waveformCounter (0), lastWaveformCounter (0),
-	new_controllers {nullptr}, controllers {0},
+	audioInputs {nullptr}, audioOutputs {nullptr}, freewheelPort (nullptr), performancePorts {nullptr},
+	notifyForge (), notifyFrame (), padNotifications (),
+	waveform {{0.0f, 0.0f}}, waveformCounter (0), lastWaveformCounter (0),
+	waveformBuffer {{0.0f, 0.0f}}, waveformTransport {0}, waveformOutdated (false), waveformRequested (false),
+	new_controllers {nullptr}, controllers {0}, rawControllers {0},
 	editMode (0), midiLearn (false), nrPages (1),
 	schedulePage (0), playPage (0), lastPage (0),
-	pads {Pad()}, patternFlipped (false),
-	sample (nullptr), sampleAmp (1.0f),
-	rate (samplerate), bpm (120.0f), beatsPerBar (4.0f), beatUnit (0),
+	patterns (new PatternSet ()), pads (patterns->pads), restoredPatterns (nullptr), retiredPatterns (nullptr),
+	patternFlipped (false), padsVersion (0),
+	padSchedules (), padSchedule (&padSchedules[0]), padScheduleRequested (false),
+	tapOffsets {0}, tapShift (0), mixKernels (), midiPageTable (),
+	performanceMeter (), trace (), rtLog (), logDrainRequested (false), logMessageTimeout (0),
+	activePads (0), objectHandlers {},
+	sample (nullptr), sampleAmp (1.0f), stateLock (), stateSnapshot (nullptr), freeMutex (),
+	rate (samplerate), nrChannels (channels), maxBlockLength (0), nominalBlockLength (0), bpm (120.0f), beatsPerBar (4.0f), beatUnit (0),
 	speed (0.0f), bar (0), barBeat (0.0f),
-	outCapacity (0), position (0.0), cursor (0.0f), offset (0.0), refFrame (0),
+	outCapacity (0), position (0.0), positionInc (0.0), cursor (0.0f), offset (0.0), refFrame (0),
 	progressionDelay (0), progressionDelayFrac (0),
-	maxBufferSize (samplerate * 24 * 32),
-	audioBuffer1 (maxBufferSize, 0.0f),
-	audioBuffer2 (maxBufferSize, 0.0f),
-	audioBufferCounter (0), audioBufferSize (samplerate * 8),
-	activated (false),
-	ui_on (false), scheduleNotifyPadsToGui (false),
-	scheduleNotifyFullPatternToGui {false},
+	maxBufferSize (samplerate * 24 * 32), history (nullptr), historyRequested (false),
+	historyShrinkTimeout (HISTORY_SHRINK_TIME * samplerate), historyRetryTimeout (0), mixBuffer (),
+	audioBufferCounter (0), audioBufferSize (samplerate * 8), requiredBufferSize (samplerate * 8),
+	activated (false), freewheeling (false),
+	ui_on (false),
 	scheduleNotifySchedulePageToGui (false),
 	scheduleNotifyPlaybackPageToGui (false),
 	scheduleNotifyStatusToGui (false),
 	scheduleNotifyWaveformToGui (false), scheduleNotifySamplePathToGui (false),
 	scheduleNotifyMidiLearnedToGui (false),
 	scheduleNotifyStateChanged (false),
-	message ()
+	message (), telemetry (),
+	statusNotified (false), notifiedCursor (0.0f), notifiedDelay (0.0f), notifiedFlipped (false)
 
 {
-	// Inits
-	for (std::array <PadMessage, MAXSTEPS * MAXSTEPS>& p : padMessageBuffer)
-	{
-		p.fill ({PadMessage()});
-		p[0] = PadMessage (ENDPADMESSAGE);
-	};
-
 	//Scan host features for URID map
 	LV2_URID_Map* m = NULL;
 	LV2_URID_Unmap* u = NULL;
+	const LV2_Options_Option* options = NULL;
 	for (int i = 0; features[i]; ++i)
 	{
 		if (strcmp (features[i]->URI, LV2_URID__map) == 0)
@@ -88,6 +110,11 @@ BJumblr::BJumblr (double samplerate, const LV2_Feature* const* features) :
 		{
                         workerSchedule = (LV2_Worker_Schedule*)features[i]->data;
 		}
+
+		else if (!strcmp(features[i]->URI, LV2_OPTIONS__options))
+		{
+			options = (const LV2_Options_Option*) features[i]->data;
+		}
 	}
 
 	if (!m) throw std::invalid_argument ("BJumblr.lv2: Host does not support urid:map.");
@@ -112,202 +139,643 @@ BJumblr::BJumblr (double samplerate, const LV2_Feature* const* features) :
 	// NR_OF_STEPS need to be set to prevent div by zero.
 	controllers[NR_OF_STEPS] = 32;
 
+	// Read block length options
+	if (options)
+	{
+		for (const LV2_Options_Option* o = options; o->key; ++o)
+		{
+			if ((o->key == uris.bufsz_maxBlockLength) && (o->type == uris.atom_Int)) maxBlockLength = *(const int32_t*) o->value;
+			else if ((o->key == uris.bufsz_nominalBlockLength) && (o->type == uris.atom_Int)) nominalBlockLength = *(const int32_t*) o->value;
+		}
+	}
+	if (maxBlockLength <= 0) maxBlockLength = (nominalBlockLength > 0 ? nominalBlockLength : DEFAULT_BLOCKLENGTH);
+
+	// Preallocate per-block working memory
+	mixBuffer.assign (nrChannels * maxBlockLength, 0.0f);
+
+	// Allocate history for the initial pattern length (+ 25 % headroom)
+	// and one block
+	history = new FrameRing (nrChannels, requiredBufferSize + requiredBufferSize / 4 + maxBlockLength);
+
+	// Compile initial pads
+	padSchedule->build (patterns->pads, controllers[NR_OF_STEPS], padsVersion);
+
 	ui_on = false;
 
+	// Dispatch table for control port objects
+	addObjectHandler (uris.ui_on, &BJumblr::onUiOn);
+	addObjectHandler (uris.ui_off, &BJumblr::onUiOff);
+	addObjectHandler (uris.notify_padEvent, &BJumblr::onPadEvent, true);
+	addObjectHandler (uris.notify_statusEvent, &BJumblr::onStatusEvent, true);
+	addObjectHandler (uris.notify_pathEvent, &BJumblr::onPathEvent, true);
+	addObjectHandler (uris.notify_traceEvent, &BJumblr::onTraceEvent);
+	addObjectHandler (uris.time_Position, &BJumblr::onTimePosition);
+
+	// Select mixing kernels for this CPU
+	mixKernels = getMixKernels ();
+
+	telemetry.setRate (samplerate, GUI_UPDATE_RATE);
 }
 
 BJumblr::~BJumblr()
 {
 	if (sample) delete sample;
+	if (history) delete history;
+	delete patterns;
+	delete restoredPatterns.load ();
+	delete retiredPatterns;
+	delete stateSnapshot;
 }
 
 void BJumblr::connect_port (uint32_t port, void *data)
 {
-	switch (port)
+	// Port layout depends on the number of channels (see Ports.hpp)
+	const int p = port;
+	const int controllersPort = getControllersPort (nrChannels);
+
+	if (p == CONTROL) controlPort = (LV2_Atom_Sequence*) data;
+	else if (p == NOTIFY) notifyPort = (LV2_Atom_Sequence*) data;
+	else if ((p >= getAudioInPort (nrChannels, 0)) && (p < getAudioOutPort (nrChannels, 0))) audioInputs[p - getAudioInPort (nrChannels, 0)] = (float*) data;
+	else if ((p >= getAudioOutPort (nrChannels, 0)) && (p < controllersPort)) audioOutputs[p - getAudioOutPort (nrChannels, 0)] = (float*) data;
+	else if (p == getFreewheelPort (nrChannels)) freewheelPort = (float*) data;
+	else if ((p >= getPerformancePort (nrChannels)) && (p < getPerformancePort (nrChannels) + NR_PERFORMANCE_PORTS))
 	{
-		case CONTROL:
-			controlPort = (LV2_Atom_Sequence*) data;
-			break;
-		case NOTIFY:
-			notifyPort = (LV2_Atom_Sequence*) data;
-			break;
-		case AUDIO_IN_1:
-			audioInput1 = (float*) data;
-			break;
-		case AUDIO_IN_2:
-			audioInput2 = (float*) data;
-			break;
-		case AUDIO_OUT_1:
-			audioOutput1 = (float*) data;
-			break;
-		case AUDIO_OUT_2:
-			audioOutput2 = (float*) data;
-			break;
-		default:
-			// Connect controllers
-			if ((port >= CONTROLLERS) && (port < CONTROLLERS + MAXCONTROLLERS)) new_controllers[port - CONTROLLERS] = (float*) data;
+		performancePorts[p - getPerformancePort (nrChannels)] = (float*) data;
+	}
+
+	// Connect controllers
+	else if ((p >= controllersPort) && (p < controllersPort + MAXCONTROLLERS))
+	{
+		new_controllers[p - controllersPort] = (float*) data;
+		rawControllers[p - controllersPort] = NAN;	// Force validation
 	}
 }
 
+/*
+ * Processes the frames from start to end using the sequencer kernel
+ * specialized for the number of channels and the actual SOURCE, PLAY, edit
+ * mode, STEP_BASE and freewheeling state.
+ * @param start		Start frame within the host buffer
+ * @param end		End frame (exclusive) within the host buffer
+ */
 void BJumblr::runSequencer (const int start, const int end)
 {
-	int iNrOfSteps = controllers[NR_OF_STEPS];
-	double delay = progressionDelay + controllers[MANUAL_PROGRSSION_DELAY];
-
-	// Calculate start position data
-	double relpos = getPositionFromFrames (start - refFrame);	// Position relative to reference frame
-	double pos = floorfrac (position + relpos);			// 0..1 position
-	double step = floormod (pos * controllers[NR_OF_STEPS] + controllers[STEP_OFFSET] + delay, controllers[NR_OF_STEPS]);	// 0..NR_OF_STEPS position
+	typedef void (BJumblr::*SequencerKernel) (const int start, const int end);
+
+#define BJUMBLR_KERNELS_MONITOR(channels, source, play, mode, base) \
+	&BJumblr::runSequencer<channels, source, play, mode, base, false>, \
+	&BJumblr::runSequencer<channels, source, play, mode, base, true>
+#define BJUMBLR_KERNELS_BASE(channels, source, play, mode) \
+	BJUMBLR_KERNELS_MONITOR (channels, source, play, mode, SECONDS), \
+	BJUMBLR_KERNELS_MONITOR (channels, source, play, mode, BEATS), \
+	BJUMBLR_KERNELS_MONITOR (channels, source, play, mode, BARS)
+#define BJUMBLR_KERNELS_MODE(channels, source, play) \
+	BJUMBLR_KERNELS_BASE (channels, source, play, 0), \
+	BJUMBLR_KERNELS_BASE (channels, source, play, 1)
+#define BJUMBLR_KERNELS_PLAY(channels, source) \
+	BJUMBLR_KERNELS_MODE (channels, source, 0), \
+	BJUMBLR_KERNELS_MODE (channels, source, 1), \
+	BJUMBLR_KERNELS_MODE (channels, source, 2)
+#define BJUMBLR_KERNELS_SOURCE(channels) \
+	BJUMBLR_KERNELS_PLAY (channels, 0), \
+	BJUMBLR_KERNELS_PLAY (channels, 1)
+
+	// Channel variants 1, 2, 4, 6 are indexed by channels / 2
+	static const SequencerKernel kernels[4 * 2 * 3 * 2 * 3 * 2] =
+	{
+		BJUMBLR_KERNELS_SOURCE (1), BJUMBLR_KERNELS_SOURCE (2),
+		BJUMBLR_KERNELS_SOURCE (4), BJUMBLR_KERNELS_SOURCE (6)
+	};
 
+#undef BJUMBLR_KERNELS_SOURCE
+#undef BJUMBLR_KERNELS_PLAY
+#undef BJUMBLR_KERNELS_MODE
+#undef BJUMBLR_KERNELS_BASE
+#undef BJUMBLR_KERNELS_MONITOR
+
+	const int source = LIMIT (int (controllers[SOURCE]), 0, 1);
+	const int play = LIMIT (int (controllers[PLAY]), 0, 2);
+	const int mode = (editMode == 1 ? 1 : 0);
+	const int base = LIMIT (int (controllers[STEP_BASE]), SECONDS, BARS);
+	const int monitor = (freewheeling ? 0 : 1);
+	updatePositionIncrement (start);
+	(this->*kernels[(((((nrChannels / 2) * 2 + source) * 3 + play) * 2 + mode) * 3 + base) * 2 + monitor]) (start, end);
+}
 
-	for (int i = start; i < end; ++i)
+/*
+ * Sequencer kernel for a fixed combination of the number of channels,
+ * SOURCE (0 = audio stream, 1 = sample), PLAY (0 = stop, 1 = play, 2 = bypass), edit mode (0 = add,
+ * 1 = replace), STEP_BASE and monitor (waveform update, off while
+ * freewheeling). All mode decisions are resolved at compile time.
+ * @param start		Start frame within the host buffer
+ * @param end		End frame (exclusive) within the host buffer
+ */
+template <int channels, int source, int play, int mode, int base, bool monitor>
+void BJumblr::runSequencer (const int start, const int end)
+{
+	const double nrOfSteps = controllers[NR_OF_STEPS];
+	const double delay = progressionDelay + controllers[MANUAL_PROGRSSION_DELAY];
+	const double posInc = positionInc;						// Position change per frame
+	const double stepInc = posInc * nrOfSteps;					// Step change per frame
+	const double stepDuration = getStepDuration<base> ();
+	const double fadeSteps = (stepDuration > 0.0 ? FADETIME / stepDuration : 0.0);	// Fade time in steps
+
+	// Buffer offsets for each step distance and delay shift. Rounded up in
+	// integers, thus exact multiples of the step length stay exact.
+	const int iNrOfSteps = controllers[NR_OF_STEPS];
+	for (int d = 0; d < iNrOfSteps; ++d)
 	{
-		int iStep = step;
+		const size_t delayFrames = (audioBufferSize * d + iNrOfSteps - 1) / iNrOfSteps;
+		tapOffsets[d] = history->size () - LIMIT (delayFrames, 0, history->size ());
+	}
+	tapShift = floormod (ceil (delay), iNrOfSteps);
 
-		float input1 = 0;
-		float input2 = 0;
+	// Calculate start position data
+	double pos = getPosition (start);							// 0..1 position
+	double step = floormod (pos * nrOfSteps + controllers[STEP_OFFSET] + delay, nrOfSteps);	// 0..NR_OF_STEPS position
 
-		// Store audio input signal to buffer
-		if (controllers[SOURCE] == 0)	// Audio stream
+	// Process sub-blocks of constant step, pattern cycle and fade state
+	for (int i = start; i < end; )
+	{
+		const int iStep = step;
+		const double frac = step - iStep;
+		const bool fading = (play == 1) && (frac < fadeSteps);
+
+		// Find end of sub-block
+		int nr = end - i;
+		nr = framesBeforeCrossing (frac, stepInc, 1.0, nr);
+		nr = framesBeforeCrossing (frac, stepInc, 0.0, nr);
+		nr = framesBeforeCrossing (pos, posInc, 1.0, nr);
+		nr = framesBeforeCrossing (pos, posInc, 0.0, nr);
+		if (play == 1)
 		{
-			input1 = audioInput1[i];
-			input2 = audioInput2[i];
+			nr = framesBeforeCrossing (frac, stepInc, fadeSteps, nr);
+			if (schedulePage != playPage) nr = framesBeforeCrossing (frac, stepInc, 0.1 * fadeSteps, nr);
 		}
-		else	// Sample
-		{
-			input1 = 0;
-			input2 = 0;
 
-			if (sample)
+		// Store audio input signal to buffer
+		storeInput<channels, source, base> (i, nr, pos, posInc);
+
+		if (play == 1)	// Play
+		{
+			if (fading)
 			{
-				if (sample->end > sample->start)
+				// Begin of step: Page change scheduled ?
+				if ((frac < 0.1 * fadeSteps) && (schedulePage != playPage))
 				{
-					const uint64_t f0 = getFramesFromValue (pos * controllers[NR_OF_STEPS] * controllers[STEP_SIZE]);
-					const int64_t frame = (sample->loop ? (f0 % (sample->end - sample->start)) + sample->start : f0 + sample->start);
-
-					if (frame < sample->end)
-					{
-						input1 = sampleAmp * sample->get (frame, 0, rate);
-						input2 = sampleAmp * sample->get (frame, 1, rate);
-					}
+					stateLock.beginWrite ();
+					playPage = schedulePage;
+					stateLock.endWrite ();
+					trace.push (TRACE_PAGE, playPage);
+					scheduleNotifyPlaybackPageToGui = true;
+					scheduleNotifyStateChanged = true;
 				}
 			}
-		}
 
-		audioBuffer1[audioBufferCounter] = input1;
-		audioBuffer2[audioBufferCounter] = input2;
+			else lastPage = playPage;
+
+			playPads<channels, mode> (i, nr, iStep, (fading ? frac / fadeSteps : 1.0), (fading ? stepInc / fadeSteps : 0.0));
+			if (monitor) updateWaveform (nr, pos, posInc);
+		}
 
-		if (controllers[PLAY] == 1.0f)	// Play
+		else if (play == 2)	// Bypass
 		{
-			double fracTime = 0;					// Time from start of step
-			switch (int (controllers[STEP_BASE]))
+			for (int j = 0; j < nr; )
 			{
-				case SECONDS:	fracTime = (step - iStep) * controllers[STEP_SIZE];
-						break;
+				const float* frames = history->frame (audioBufferCounter + j);
+				const int n = std::min<size_t> (nr - j, history->framesToEnd (audioBufferCounter + j));
+				for (int k = 0; k < n; ++k)
+				{
+					for (int c = 0; c < channels; ++c) audioOutputs[c][i + j + k] = frames[channels * k + c];
+				}
+				j += n;
+			}
+			activePads = 0;
+			if (monitor) updateWaveform (nr, pos, posInc);
+		}
 
-				case BEATS:	fracTime = (step - iStep) * controllers[STEP_SIZE] / (bpm / 60);
-						break;
+		else	// Stop
+		{
+			activePads = 0;
+			for (int c = 0; c < channels; ++c) std::fill (&audioOutputs[c][i], &audioOutputs[c][i + nr], 0.0f);
+		}
 
-				case BARS:	fracTime = (step - iStep) * controllers[STEP_SIZE] / (bpm / (60 * beatsPerBar));
-						break;
+		// Increment counter
+		audioBufferCounter += nr;
+		i += nr;
 
-				default:	break;
+		// Calculate next position
+		pos = getPosition (i);
+		step = floormod (pos * nrOfSteps + controllers[STEP_OFFSET] + delay, nrOfSteps);
 
-			}
+		// Change step ? Update delaySteps
+		if (int (step) != iStep)
+		{
+			trace.push (TRACE_STEP, int (step));
+			progressionDelayFrac += controllers[SPEED] - 1;
+			double floorDelayFrac = floor (progressionDelayFrac);
+			progressionDelay += floorDelayFrac;
+			progressionDelayFrac -= floorDelayFrac;
+			scheduleNotifyStatusToGui = true;
+		}
+	}
+}
 
-			double fade = (fracTime < FADETIME ? fracTime / FADETIME : 1.0);
+/*
+ * Stores nr frames of the audio input signal (audio stream or sample) to the
+ * audio buffer.
+ * @param start		Start frame within the host buffer
+ * @param nr		Number of frames
+ * @param pos		0..1 position of the start frame
+ * @param posInc	Position change per frame
+ */
+template <int channels, int source, int base>
+void BJumblr::storeInput (const int start, const int nr, const double pos, const double posInc)
+{
+	if (source == 0)	// Audio stream
+	{
+		for (int j = 0; j < nr; )
+		{
+			float* frames = history->frame (audioBufferCounter + j);
+			const int n = std::min<size_t> (nr - j, history->framesToEnd (audioBufferCounter + j));
+			for (int k = 0; k < n; ++k)
+			{
+				for (int c = 0; c < channels; ++c) frames[channels * k + c] = audioInputs[c][start + j + k];
+			}
+			j += n;
+		}
+	}
 
-			double prevAudio1 = 0;
-			double prevAudio2 = 0;
-			double audio1 = 0;
-			double audio2 = 0;
+	else	// Sample
+	{
+		const bool valid = sample && (sample->end > sample->start);
+		const double framesPerPos = controllers[NR_OF_STEPS] * controllers[STEP_SIZE] * getFramesPerValue<base> ();
+		const double f0 = pos * framesPerPos;					// Sample frame of the start frame
+		const double fInc = posInc * framesPerPos;				// Sample frame change per frame
+		const int64_t length = (valid ? sample->end - sample->start : 0);
+		int64_t wrap = (valid && sample->loop ? (int64_t (f0) / length) * length : 0);	// Sample frames skipped by looping
+
+		for (int j = 0; j < nr; ++j)
+		{
+			float* frame = history->frame (audioBufferCounter + j);
+			std::fill (frame, frame + channels, 0.0f);
 
-			// Fade out: Extrapolate audio using previous step data
-			if (fade < 1.0)
+			if (valid)
 			{
-				// Begin of step: Page change scheduled ?
-				if ((fade < 0.1) && (schedulePage != playPage))
-				{
-					playPage = schedulePage;
-					scheduleNotifyPlaybackPageToGui = true;
-					scheduleNotifyStateChanged = true;
-				}
-
-				int iPrevStep = (fade < 1.0 ? (iStep + iNrOfSteps - 1) % iNrOfSteps : iStep);	// Previous step
-				for (int r = 0; r < iNrOfSteps; ++r)
+				int64_t f = int64_t (f0 + j * fInc) - wrap;
+				if (sample->loop)
 				{
-					float factor = pads[lastPage][r][iPrevStep].level;
-					if (factor != 0.0)
+					// Wrap in both directions (fInc < 0 for negative host speed)
+					while (f >= length)
 					{
-						int stepDiff = floormod (iPrevStep - r - delay, iNrOfSteps);
-						size_t frame = size_t (maxBufferSize + audioBufferCounter - audioBufferSize * (double (stepDiff) / double (iNrOfSteps))) % maxBufferSize;
-						prevAudio1 += factor * audioBuffer1[frame];
-						prevAudio2 += factor * audioBuffer2[frame];
-
-						if (editMode == 1) break;	// Only one active pad allowed in REPLACE mode
+						wrap += length;
+						f -= length;
+					}
+					while (f < 0)
+					{
+						wrap -= length;
+						f += length;
 					}
 				}
+				f += sample->start;
 
-			}
-
-			else lastPage = playPage;
-
-			// Calculate audio for this step
-			for (int r = 0; r < iNrOfSteps; ++r)
-			{
-				float factor = pads[playPage][r][iStep].level;
-				if (factor != 0.0)
+				if ((f >= sample->start) && (f < sample->end))
 				{
-					int stepDiff = floormod (iStep - r - delay, iNrOfSteps);
-					size_t frame = size_t (maxBufferSize + audioBufferCounter - audioBufferSize * (double (stepDiff) / double (iNrOfSteps))) % maxBufferSize;
-					audio1 += factor * audioBuffer1[frame];
-					audio2 += factor * audioBuffer2[frame];
-
-					if (editMode == 1) break;	// Only one active pad allowed in REPLACE mode
+					// Sample channels are repeated if the plugin has more channels
+					for (int c = 0; c < channels; ++c) frame[c] = sampleAmp * sample->get (f, c % sample->info.channels, rate);
 				}
 			}
+		}
+	}
+}
+
+/*
+ * Mixes nr frames of the buffered audio signal to the output as defined by
+ * the pads of the actual step. Crossfades from the previous step as long as
+ * fade < 1.0. The pads are mixed to the interleaved mix buffer which is
+ * then copied to the outputs (in chunks of maxBlockLength frames if the
+ * host exceeds maxBlockLength).
+ * @param start		Start frame within the host buffer
+ * @param nr		Number of frames
+ * @param iStep		Actual step
+ * @param fade		Crossfade factor of the start frame
+ * @param fadeInc	Crossfade factor change per frame
+ */
+template <int channels, int mode>
+void BJumblr::playPads (const int start, const int nr, const int iStep, const double fade, const double fadeInc)
+{
+	PadTap taps[MAXSTEPS];
+	const int nrTaps = getPadTaps<mode> (playPage, iStep, taps);
+	activePads = nrTaps;
+
+	// Fade out: Extrapolate audio using previous step data
+	PadTap prevTaps[MAXSTEPS];
+	int nrPrevTaps = 0;
+	if (fade < 1.0)
+	{
+		const int iNrOfSteps = controllers[NR_OF_STEPS];
+		const int iPrevStep = (iStep + iNrOfSteps - 1) % iNrOfSteps;
+		nrPrevTaps = getPadTaps<mode> (lastPage, iPrevStep, prevTaps);
+	}
+
+	for (int j = 0; j < nr; j += maxBlockLength)
+	{
+		const int n = std::min (nr - j, maxBlockLength);
+		std::fill (mixBuffer.begin (), mixBuffer.begin () + channels * n, 0.0f);
 
-			// Mix audio and store into output
-			audioOutput1[i] = fade * audio1 + (1 - fade) * prevAudio1;
-			audioOutput2[i] = fade * audio2 + (1 - fade) * prevAudio2;
+		if (fade >= 1.0)
+		{
+			for (int t = 0; t < nrTaps; ++t) mixTap<channels> (j, n, taps[t].offset, taps[t].level, 0.0f);
+		}
 
-			waveformCounter = int ((pos + controllers[STEP_OFFSET] / controllers[NR_OF_STEPS]) * WAVEFORMSIZE) % WAVEFORMSIZE;
-			waveform[waveformCounter] = (input1 + input2) / 2;
+		else
+		{
+			for (int t = 0; t < nrPrevTaps; ++t) mixTap<channels> (j, n, prevTaps[t].offset, prevTaps[t].level * (1.0 - fade), -prevTaps[t].level * fadeInc);
+			for (int t = 0; t < nrTaps; ++t) mixTap<channels> (j, n, taps[t].offset, taps[t].level * fade, taps[t].level * fadeInc);
 		}
 
-		else if (controllers[PLAY] == 2.0f)	// Bypass
+		for (int k = 0; k < n; ++k)
 		{
-			audioOutput1[i] = input1;
-			audioOutput2[i] = input2;
+			for (int c = 0; c < channels; ++c) audioOutputs[c][start + j + k] = mixBuffer[channels * k + c];
+		}
+	}
+}
+
+/*
+ * Adds nr frames of the buffered audio signal to the mix buffer. The
+ * buffered signal is read from offset frames after the actual audio buffer
+ * position in up to two contiguous segments (before and after the buffer
+ * wraps).
+ * @param start		Start frame relative to the actual audio buffer
+ *			position (= relative to the sub-block start)
+ * @param nr		Number of frames
+ * @param offset	Audio buffer read offset
+ * @param gain		Gain of the frame at audio buffer position
+ * @param gainInc	Gain change per frame
+ */
+template <int channels>
+void BJumblr::mixTap (const int start, const int nr, const size_t offset, const float gain, const float gainInc)
+{
+	for (int j = 0; j < nr; )
+	{
+		const size_t frame = audioBufferCounter + offset + start + j;
+		const int n = std::min<size_t> (nr - j, history->framesToEnd (frame));
+
+		if (gainInc == 0.0f) mixKernels.mac (&mixBuffer[channels * j], history->frame (frame), channels * n, gain);
+		else if (channels == 2) mixKernels.macRamp (&mixBuffer[channels * j], history->frame (frame), n, gain + (start + j) * gainInc, gainInc);
+		else macRampFrames<channels> (&mixBuffer[channels * j], history->frame (frame), n, gain + (start + j) * gainInc, gainInc);
+
+		j += n;
+	}
+}
+
+/*
+ * Collects the active pads of a step together with their audio buffer
+ * offsets. Uses the compiled pads if up to date, otherwise scans the pads.
+ * @param page		Page
+ * @param iStep		Step
+ * @param taps		Array of at least MAXSTEPS PadTaps to be filled
+ * @return		Number of active pads
+ */
+template <int mode>
+int BJumblr::getPadTaps (const int page, const int iStep, PadTap* taps) const
+{
+	const int iNrOfSteps = controllers[NR_OF_STEPS];
+	int nr = 0;
 
-			waveformCounter = int ((pos + controllers[STEP_OFFSET] / controllers[NR_OF_STEPS]) * WAVEFORMSIZE) % WAVEFORMSIZE;
-			waveform[waveformCounter] = (input1 + input2) / 2;
+	if ((padSchedule->version == padsVersion) && (padSchedule->nrOfSteps == iNrOfSteps))
+	{
+		const int size = (mode == 1 ? LIMIT (padSchedule->size[page][iStep], 0, 1) : padSchedule->size[page][iStep]);	// Only one active pad allowed in REPLACE mode
+		const PadScheduleEntry* entries = padSchedule->entries[page][iStep];
+		for (; nr < size; ++nr)
+		{
+			taps[nr].level = entries[nr].level;
+			taps[nr].offset = tapOffsets[(entries[nr].stepDiff + iNrOfSteps - tapShift) % iNrOfSteps];
 		}
+	}
 
-		else	// Stop
+	else
+	{
+		for (int r = 0; r < iNrOfSteps; ++r)
 		{
-			audioOutput1[i] = 0;
-			audioOutput2[i] = 0;
+			const float factor = pads[page][r][iStep].level;
+			if (factor != 0.0)
+			{
+				taps[nr].level = factor;
+				taps[nr].offset = tapOffsets[(iStep - r + 2 * iNrOfSteps - tapShift) % iNrOfSteps];
+				++nr;
+
+				if (mode == 1) break;	// Only one active pad allowed in REPLACE mode
+			}
 		}
+	}
 
-		// Calculate next position
-		relpos = getPositionFromFrames (i + 1 - refFrame);
-		pos = floorfrac (position + relpos);
-		step = floormod (pos * controllers[NR_OF_STEPS] + controllers[STEP_OFFSET] + delay, controllers[NR_OF_STEPS]);
+	return nr;
+}
 
-		// Change step ? Update delaySteps
-		int nextiStep = step;
-		if (nextiStep != iStep)
+/*
+ * Schedules a worker job and records it in the trace. Audio thread only.
+ * @param size		Size of the message
+ * @param data		Message
+ * @return		Status returned by the host
+ */
+LV2_Worker_Status BJumblr::scheduleWork (const uint32_t size, const void* data)
+{
+	trace.push (TRACE_SCHEDULE_WORK, ((const LV2_Atom*) data)->type);
+	return workerSchedule->schedule_work (workerSchedule->handle, size, data);
+}
+
+/*
+ * Schedules the worker to (re)compile the pads into the spare pad schedule.
+ */
+void BJumblr::requestPadSchedule ()
+{
+	ScheduleMessage msg;
+	msg.atom = {sizeof (ScheduleMessage) - sizeof (LV2_Atom), uris.notify_buildSchedule};
+	msg.schedule = (padSchedule == &padSchedules[0] ? &padSchedules[1] : &padSchedules[0]);
+	msg.patterns = patterns;
+	msg.version = padsVersion;
+	msg.nrOfSteps = controllers[NR_OF_STEPS];
+	if (scheduleWork (sizeof (msg), &msg) == LV2_WORKER_SUCCESS) padScheduleRequested = true;
+}
+
+/*
+ * Takes over the data restored in a pattern set. The pads are taken over by
+ * swapping the pattern set.
+ * @param patternSet	Restored pattern set
+ * @return		Pattern set to be freed (the replaced or the restored
+ *			one)
+ */
+PatternSet* BJumblr::installPatterns (PatternSet* patternSet)
+{
+	if (patternSet->patternFlipped >= 0)
+	{
+		patternFlipped = patternSet->patternFlipped;
+		scheduleNotifyStatusToGui = true;
+	}
+
+	if (patternSet->playPage >= 0)
+	{
+		playPage = patternSet->playPage;
+		scheduleNotifyPlaybackPageToGui = true;
+	}
+
+	if (patternSet->editMode >= 0) editMode = patternSet->editMode;
+
+	scheduleNotifyStatusToGui = true;
+	if (!patternSet->padsRestored) return patternSet;
+
+	PatternSet* old = patterns;
+	patterns = patternSet;
+	pads = patterns->pads;
+	nrPages = patterns->nrPages;
+
+	// Force re-compilation and GUI notification
+	for (int p = 0; p < nrPages; ++p) padNotifications.markFullPattern (p);
+	++padsVersion;
+	return old;
+}
+
+/*
+ * Schedules the worker to free the retired pattern set (if any). Retries
+ * on the next call if the worker queue is full.
+ */
+void BJumblr::retirePatterns ()
+{
+	if (!retiredPatterns) return;
+
+	PatternMessage msg;
+	msg.atom = {sizeof (PatternMessage) - sizeof (LV2_Atom), uris.notify_patternFreeEvent};
+	msg.patterns = retiredPatterns;
+	if (scheduleWork (sizeof (msg), &msg) == LV2_WORKER_SUCCESS) retiredPatterns = nullptr;
+}
+
+/*
+ * Updates audioBufferSize from the pattern length. The audio buffer size is
+ * limited to the actual history size (minus one block which is written
+ * before it is read) until the worker provides a larger history.
+ */
+void BJumblr::updateAudioBufferSize ()
+{
+	const uint64_t size = getFramesFromValue (controllers[STEP_SIZE] * controllers[NR_OF_STEPS]);
+	const size_t maxSize = (history->size () > size_t (maxBlockLength) ? history->size () - maxBlockLength : 0);
+	requiredBufferSize = LIMIT (size, 0, maxBufferSize);
+	audioBufferSize = LIMIT (requiredBufferSize, 0, maxSize);
+}
+
+/*
+ * Schedules the worker to allocate a history for the required audio buffer
+ * size (+ 25 % headroom) and one block and to copy the actual history. Used
+ * to extend and to shrink the history.
+ */
+void BJumblr::requestHistory ()
+{
+	HistoryMessage msg;
+	msg.atom = {sizeof (HistoryMessage) - sizeof (LV2_Atom), uris.notify_resizeHistory};
+	msg.history = history;
+	msg.counter = audioBufferCounter;
+	msg.size = requiredBufferSize + requiredBufferSize / 4 + maxBlockLength;
+	if (scheduleWork (sizeof (msg), &msg) == LV2_WORKER_SUCCESS) historyRequested = true;
+}
+
+/*
+ * Schedules the worker to re-calculate the waveform from the history.
+ */
+void BJumblr::requestWaveform ()
+{
+	WaveformMessage msg;
+	msg.atom = {sizeof (WaveformMessage) - sizeof (LV2_Atom), uris.notify_buildWaveform};
+	msg.history = history;
+	msg.counter = audioBufferCounter;
+	msg.size = audioBufferSize;
+	msg.position = getPosition (0) + controllers[STEP_OFFSET] / controllers[NR_OF_STEPS];
+	if (scheduleWork (sizeof (msg), &msg) == LV2_WORKER_SUCCESS)
+	{
+		waveformRequested = true;
+		waveformOutdated = false;
+	}
+}
+
+/*
+ * Schedules the worker to print the queued log messages.
+ */
+void BJumblr::requestLogDrain ()
+{
+	LV2_Atom msg = {0, uris.notify_drainLog};
+	if (scheduleWork (sizeof (msg), &msg) == LV2_WORKER_SUCCESS) logDrainRequested = true;
+}
+
+/*
+ * Queues a log message from the audio thread (printed by the worker) and
+ * shows a message in the GUI for 5 seconds. Real-time safe replacement for
+ * fprintf.
+ * @param code		LogCode
+ * @param arg0..arg2	Integer arguments of the message
+ */
+void BJumblr::logMessage (const LogCode code, const int32_t arg0, const int32_t arg1, const int32_t arg2)
+{
+	rtLog.push (code, arg0, arg1, arg2);
+	message.setMessage (INVALID_DATA_MSG);
+	logMessageTimeout = 5 * rate;
+}
+
+/*
+ * Adds nr frames of the stored input signal to the min/max envelope of the
+ * waveform buffer for the GUI monitor. A slot is reset as soon as the
+ * position enters it.
+ * @param nr		Number of frames
+ * @param pos		0..1 position of the first frame
+ * @param posInc	Position change per frame
+ */
+void BJumblr::updateWaveform (const int nr, const double pos, const double posInc)
+{
+	const double offsetPos = controllers[STEP_OFFSET] / controllers[NR_OF_STEPS];
+
+	for (int j = 0; j < nr; ++j)
+	{
+		const float* frame = history->frame (audioBufferCounter + j);
+		float sum = 0.0f;
+		for (int c = 0; c < nrChannels; ++c) sum += frame[c];
+		const float value = sum / nrChannels;
+		const int slot = int ((pos + j * posInc + offsetPos) * WAVEFORMSIZE) % WAVEFORMSIZE;
+		if (slot != waveformCounter)
 		{
-			progressionDelayFrac += controllers[SPEED] - 1;
-			double floorDelayFrac = floor (progressionDelayFrac);
-			progressionDelay += floorDelayFrac;
-			progressionDelayFrac -= floorDelayFrac;
-			scheduleNotifyStatusToGui = true;
+			waveformCounter = slot;
+			waveform[slot] = EnvelopeSlot {value, value};
+		}
+		else
+		{
+			waveform[slot].min = std::min (waveform[slot].min, value);
+			waveform[slot].max = std::max (waveform[slot].max, value);
 		}
+	}
+}
 
-		// Increment counter
-		audioBufferCounter = (audioBufferCounter + 1) % maxBufferSize;
+/*
+ * Calculates the 0..1 pattern position of a frame from the reference
+ * position and the number of frames since the reference frame. As the
+ * position isn't accumulated, no rounding error builds up over time.
+ * @param frame		Frame within the host buffer
+ * @return		0..1 position
+ */
+double BJumblr::getPosition (const int64_t frame) const
+{
+	return floorfrac (position + (frame - refFrame) * positionInc);
+}
+
+/*
+ * Re-anchors the reference position to frame if the position change per
+ * frame changed (e. g., by new STEP_SIZE or NR_OF_STEPS).
+ * @param frame		Frame within the host buffer
+ */
+void BJumblr::updatePositionIncrement (const int64_t frame)
+{
+	const double inc = getPositionFromFrames (1);
+	if (inc != positionInc)
+	{
+		position = getPosition (frame);
+		refFrame = frame;
+		positionInc = inc;
 	}
 }
 
@@ -324,11 +792,23 @@ double BJumblr::getPositionFromBeats (const double beats) const
 	}
 }
 
-double BJumblr::getPositionFromFrames (const uint64_t frames) const
+double BJumblr::getPositionFromFrames (const int64_t frames) const
+{
+	switch (int (controllers[STEP_BASE]))
+	{
+		case SECONDS: 	return getPositionFromFrames<SECONDS> (frames);
+		case BEATS:	return getPositionFromFrames<BEATS> (frames);
+		case BARS:	return getPositionFromFrames<BARS> (frames);
+		default:	return 0.0;
+	}
+}
+
+template <int base>
+double BJumblr::getPositionFromFrames (const int64_t frames) const
 {
 	if ((controllers[STEP_SIZE] == 0.0) || (rate == 0)) return 0.0;
 
-	switch (int (controllers[STEP_BASE]))
+	switch (base)
 	{
 		case SECONDS: 	return frames * (1.0 / rate) / (controllers[STEP_SIZE] * controllers[NR_OF_STEPS]);
 		case BEATS:	return (bpm ? frames * (speed / (rate / (bpm / 60))) / (controllers[STEP_SIZE] * controllers[NR_OF_STEPS]) : 0.0);
@@ -352,18 +832,58 @@ double BJumblr::getPositionFromSeconds (const double seconds) const
 
 uint64_t BJumblr::getFramesFromValue (const double value) const
 {
-	if (bpm < 1.0) return 0;
+	return value * getFramesPerValue ();
+}
 
+double BJumblr::getFramesPerValue () const
+{
 	switch (int (controllers[STEP_BASE]))
 	{
-		case SECONDS :	return value * rate;
-		case BEATS:	return value * (60.0 / bpm) * rate;
-		case BARS:	return value * beatsPerBar * (60.0 / bpm) * rate;
-		default:	return 0;
+		case SECONDS :	return getFramesPerValue<SECONDS> ();
+		case BEATS:	return getFramesPerValue<BEATS> ();
+		case BARS:	return getFramesPerValue<BARS> ();
+		default:	return 0.0;
 	}
 }
 
-void BJumblr::activate() {activated = true;}
+template <int base>
+double BJumblr::getFramesPerValue () const
+{
+	if (bpm < 1.0) return 0.0;
+
+	switch (base)
+	{
+		case SECONDS :	return rate;
+		case BEATS:	return (60.0 / bpm) * rate;
+		case BARS:	return beatsPerBar * (60.0 / bpm) * rate;
+		default:	return 0.0;
+	}
+}
+
+double BJumblr::getStepDuration () const
+{
+	switch (int (controllers[STEP_BASE]))
+	{
+		case SECONDS:	return getStepDuration<SECONDS> ();
+		case BEATS:	return getStepDuration<BEATS> ();
+		case BARS:	return getStepDuration<BARS> ();
+		default:	return 0.0;
+	}
+}
+
+template <int base>
+double BJumblr::getStepDuration () const
+{
+	switch (base)
+	{
+		case SECONDS:	return controllers[STEP_SIZE];
+		case BEATS:	return controllers[STEP_SIZE] / (bpm / 60);
+		case BARS:	return controllers[STEP_SIZE] / (bpm / (60 * beatsPerBar));
+		default:	return 0.0;
+	}
+}
+
+void BJumblr::activate() {activated = true;}
 
 void BJumblr::deactivate() {activated = false;}
 
@@ -371,31 +891,66 @@ void BJumblr::run (uint32_t n_samples)
 {
 	uint32_t last_t = 0;
 
-	if ((!controlPort) || (!notifyPort) || (!audioInput1) || (!audioInput2) || (!audioOutput1) || (!audioOutput2)) return;
+	if ((!controlPort) || (!notifyPort)) return;
+	for (int c = 0; c < nrChannels; ++c)
+	{
+		if ((!audioInputs[c]) || (!audioOutputs[c])) return;
+	}
+
+	// Performance counters are only measured if any of their ports is connected
+	bool measure = false;
+	for (const float* p : performancePorts) measure = measure || p;
+	const int64_t runStart = (measure ? PerformanceMeter::now () : 0);
+	trace.push (TRACE_RUN_BEGIN, n_samples);
+
+	// Offline processing faster than realtime: Skip GUI telemetry and monitor
+	freewheeling = (freewheelPort && (*freewheelPort != 0.0f));
+
+	// Install a pattern set published by state_restore ()
+	retirePatterns ();
+	if ((!retiredPatterns) && restoredPatterns.load (std::memory_order_relaxed))
+	{
+		PatternSet* ps = restoredPatterns.exchange (nullptr, std::memory_order_acquire);
+		if (ps)
+		{
+			stateLock.beginWrite ();
+			retiredPatterns = installPatterns (ps);
+			stateLock.endWrite ();
+			retirePatterns ();
+		}
+	}
 
 	// Init notify port
 	uint32_t space = notifyPort->atom.size;
+	outCapacity = space;
 	lv2_atom_forge_set_buffer(&notifyForge, (uint8_t*) notifyPort, space);
 	lv2_atom_forge_sequence_head(&notifyForge, &notifyFrame, 0);
 
-	// Validate controllers
+	// Validate changed controllers
+	bool midiChanged = false;
 	for (int i = 0; i < MAXCONTROLLERS; ++i)
 	{
-		if (new_controllers[i])
+		if (new_controllers[i] && (*(new_controllers[i]) != rawControllers[i]))
 		{
 			float val = validateValue (*(new_controllers[i]), controllerLimits[i]);
 			if (val != *(new_controllers[i]))
 			{
-				fprintf (stderr, "BJumblr.lv2: Value out of range in run (): Controller#%i\n", i);
+				logMessage (LOG_VALUE_OUT_OF_RANGE, i);
 				*(new_controllers[i]) = val;
 				// TODO update GUI controller
 			}
+			rawControllers[i] = val;
 
 			if (controllers[i] != val)
 			{
 				if (i == SOURCE)
 				{
 					if (val == 0.0) message.deleteMessage (CANT_OPEN_SAMPLE);
+
+					// The saved state contains the sample only for SOURCE == 1
+					stateLock.beginWrite ();
+					controllers[i] = val;
+					stateLock.endWrite ();
 				}
 
 				else if (i == STEP_BASE)
@@ -419,393 +974,597 @@ void BJumblr::run (uint32_t n_samples)
 				}
 
 				controllers[i] = val;
-				uint64_t size = getFramesFromValue (controllers[STEP_SIZE] * controllers[NR_OF_STEPS]);
-				audioBufferSize = LIMIT (size, 0, maxBufferSize);
+				updateAudioBufferSize ();
+				if (i >= MIDI) midiChanged = true;
 
-				// Also re-calculate waveform buffer for GUI
-				if ((i == SOURCE) || (i == NR_OF_STEPS) || (i == STEP_BASE) || (i == STEP_SIZE) || (i == STEP_OFFSET))
-				{
-					for (size_t i = 0; i < WAVEFORMSIZE; ++i)
-					{
-						double di = double (i) / WAVEFORMSIZE;
-						int wcount = size_t ((position + di + controllers[STEP_OFFSET] / controllers[NR_OF_STEPS]) * WAVEFORMSIZE) % WAVEFORMSIZE;
-						size_t acount = (maxBufferSize + audioBufferCounter - audioBufferSize + (i * audioBufferSize) / WAVEFORMSIZE) % maxBufferSize;
-						waveform[wcount] = (audioBuffer1[acount] + (audioBuffer2[acount])) / 2;
-					}
-					if (ui_on) notifyWaveformToGui ((waveformCounter + 1) % WAVEFORMSIZE, waveformCounter);
-				}
+				// Also re-calculate waveform buffer for GUI (by the worker)
+				if ((i == SOURCE) || (i == NR_OF_STEPS) || (i == STEP_BASE) || (i == STEP_SIZE) || (i == STEP_OFFSET)) waveformOutdated = true;
 			}
 		}
 	}
 
+	// Re-compile MIDI page triggers
+	if (midiChanged) midiPageTable.build (&controllers[MIDI]);
+
 	// Read CONTROL port (notifications from GUI and host)
 	LV2_ATOM_SEQUENCE_FOREACH (controlPort, ev)
 	{
 		if ((ev->body.type == uris.atom_Object) || (ev->body.type == uris.atom_Blank))
 		{
 			const LV2_Atom_Object* obj = (const LV2_Atom_Object*)&ev->body;
-
-			// GUI on
-			if (obj->body.otype == uris.ui_on)
+			if (obj->body.otype != uris.time_Position) telemetry.countFromGui (sizeof (LV2_Atom_Event) + ev->body.size);
+			const ObjectDispatch* dispatch = getObjectDispatch (obj->body.otype);
+			if (dispatch)
 			{
-				ui_on = true;
-				for (int i = 0; i < nrPages; ++i) scheduleNotifyFullPatternToGui[i] = true;
-				scheduleNotifyPadsToGui = true;
-				scheduleNotifyStatusToGui = true;
-				scheduleNotifySamplePathToGui = true;
+				// Only bump the state sequence if the saved state may change
+				if (dispatch->changesState) stateLock.beginWrite ();
+				(this->*(dispatch->handler)) (obj, ev->time.frames);
+				if (dispatch->changesState) stateLock.endWrite ();
 			}
+		}
 
-			// GUI off
-			else if (obj->body.otype == uris.ui_off)
+		// Read incoming MIDI events
+		else if (ev->body.type == uris.midi_Event)
+		{
+			const uint8_t* const msg = (const uint8_t*)(ev + 1);
+			const uint8_t status = (msg[0] >> 4);
+			const uint8_t channel = msg[0] & 0x0F;
+			const uint8_t note = ((status == 8) || (status == 9) || (status == 11) ? msg[1] : 0);
+			const uint8_t value = ((status == 8) || (status == 9) || (status == 11) ? msg[2] : 0);
+
+			if (midiLearn)
 			{
-				ui_on = false;
+				midiLearned[0] = status;
+				midiLearned[1] = channel;
+				midiLearned[2] = note;
+				midiLearned[3] = value;
+				midiLearn = false;
+				scheduleNotifyMidiLearnedToGui = true;
 			}
 
-			// GUI pad changed notifications
-			else if (obj->body.otype == uris.notify_padEvent)
+			else
 			{
-				LV2_Atom *oEd = NULL, *oPg = NULL, *oPd = NULL, *oPat = NULL;
-				int page = -1;
-				lv2_atom_object_get (obj,
-					 	     uris.notify_editMode, &oEd,
-						     uris.notify_padPage, &oPg,
-						     uris.notify_pad, &oPd,
-						     uris.notify_padFullPattern, &oPat,
-						     NULL);
-
-				// EditMode notification
-				if (oEd && (oEd->type == uris.atom_Int)) editMode = ((LV2_Atom_Int*)oEd)->body;
-
-				// padPage notification
-				if (oPg && (oPg->type == uris.atom_Int))
-				{
-					page = ((LV2_Atom_Int*)oPg)->body;
-					if (page >= nrPages)
-					{
-						nrPages = LIMIT (page + 1, 1, MAXPAGES);
-						if (playPage >= nrPages)
-						{
-							schedulePage = nrPages - 1;
-							scheduleNotifySchedulePageToGui = true;
-						}
-					}
-				}
-
-				// Pad notification
-				if (oPd && (oPd->type == uris.atom_Vector) && (page >= 0) && (page < MAXPAGES))
-				{
-					const LV2_Atom_Vector* vec = (const LV2_Atom_Vector*) oPd;
-					if (vec->body.child_type == uris.atom_Float)
-					{
-						const uint32_t size = (uint32_t) ((oPd->size - sizeof(LV2_Atom_Vector_Body)) / sizeof (PadMessage));
-						PadMessage* pMes = (PadMessage*) (&vec->body + 1);
-
-						for (unsigned int i = 0; i < size; ++i)
-						{
-							int row = pMes[i].row;
-							int step = pMes[i].step;
-
-							// Copy PadMessages to pads
-							if ((row >= 0) && (row < MAXSTEPS) && (step >= 0) && (step < MAXSTEPS))
-							{
-								Pad pd (pMes[i].level);
-								Pad valPad = validatePad (pd);
-								pads[page][row][step] = valPad;
-								if (valPad != pd)
-								{
-									fprintf (stderr, "BJumblr.lv2: Pad out of range in run (): pads[%i][%i][%i].\n", page, row, step);
-									padMessageBufferAppendPad (page, row, step, valPad);
-									scheduleNotifyPadsToGui = true;
-								}
-								scheduleNotifyStateChanged = true;
-							}
-						}
-					}
-				}
 
-				// Full pattern notification
-				if (oPat && (oPat->type == uris.atom_Vector) && (page >= 0) && (page < MAXPAGES))
+				const int p = midiPageTable.getPage (status, channel, note, value, nrPages);
+				if (p >= 0)
 				{
-					const LV2_Atom_Vector* vec = (const LV2_Atom_Vector*) oPat;
-					if (vec->body.child_type == uris.atom_Float)
-					{
-						const uint32_t size = (uint32_t) ((oPat->size - sizeof(LV2_Atom_Vector_Body)) / sizeof (Pad));
-						Pad* data = (Pad*) (&vec->body + 1);
-
-						if (size == MAXSTEPS * MAXSTEPS)
-						{
-							// Copy pattern data
-							for (int r = 0; r < MAXSTEPS; ++r)
-							{
-								for (int s = 0; s < MAXSTEPS; ++s)
-								{
-									pads[page][r][s] = data[r * MAXSTEPS + s];
-								}
-							}
-
-							scheduleNotifyStateChanged = true;
-						}
-
-						else fprintf (stderr, "BJumblr.lv2: Corrupt pattern size of %i for page %i.\n", size, page);
-					}
+					trace.push (TRACE_MIDI, p);
+					schedulePage = p;
+					scheduleNotifySchedulePageToGui = true;
 				}
 			}
+		}
 
-			// Status notifications
-			else if (obj->body.otype == uris.notify_statusEvent)
-			{
-				LV2_Atom *oMx = NULL, *oPp = NULL, *oMl = NULL, *oFlip = NULL;
-				lv2_atom_object_get (obj,
-					 	     uris.notify_maxPage, &oMx,
-						     uris.notify_playbackPage, &oPp,
-						     uris.notify_requestMidiLearn, &oMl,
-						     uris.notify_padFlipped, &oFlip,
-						     NULL);
-
-				// padMaxPage notification
-				if (oMx && (oMx->type == uris.atom_Int))
-				{
-					int newPages = ((LV2_Atom_Int*)oMx)->body;
-					if (newPages != nrPages)
-					{
-						nrPages = LIMIT (newPages, 1, MAXPAGES);
-						if (playPage >= nrPages)
-						{
-							schedulePage = nrPages - 1;
-							scheduleNotifyPlaybackPageToGui = true;
-						}
-					}
-				}
+		// Update for this iteration
+		uint32_t next_t = (ev->time.frames < n_samples ? ev->time.frames : n_samples);
+		runSequencer (last_t, next_t);
+		last_t = next_t;
+	}
 
-				// playbackPage notification
-				if (oPp && (oPp->type == uris.atom_Int))
-				{
-					int newPp = ((LV2_Atom_Int*)oPp)->body;
-					if (newPp != playPage)
-					{
-						playPage = LIMIT (newPp, 0, MAXPAGES - 1);
-						scheduleNotifyStateChanged = true;
-					}
-				}
+	// Update for the remainder of the cycle
+	if (last_t < n_samples) runSequencer (last_t, n_samples);
 
-				// Midi learn request notification
-				if (oMl && (oMl->type == uris.atom_Bool)) midiLearn = ((LV2_Atom_Bool*)oMl)->body;
+	// Re-compile changed pads
+	if
+	(
+		(!padScheduleRequested) &&
+		((padSchedule->version != padsVersion) || (padSchedule->nrOfSteps != int (controllers[NR_OF_STEPS])))
+	) requestPadSchedule ();
+
+	// Extend history if too short for the pattern. Shrink it if the pattern
+	// needed less than a quarter of it for HISTORY_SHRINK_TIME.
+	const size_t historyRequired = requiredBufferSize + maxBlockLength;
+	if (4 * historyRequired < history->size ()) historyShrinkTimeout -= n_samples;
+	else historyShrinkTimeout = HISTORY_SHRINK_TIME * rate;
+	if (historyRetryTimeout > 0) historyRetryTimeout -= n_samples;
+	if
+	(
+		(!historyRequested) && (historyRetryTimeout <= 0) &&
+		((historyRequired > history->size ()) || (historyShrinkTimeout <= 0))
+	) requestHistory ();
+
+	// Print queued log messages and remove outdated log message from GUI
+	if ((!logDrainRequested) && rtLog.pending ()) requestLogDrain ();
+	if (logMessageTimeout > 0)
+	{
+		logMessageTimeout -= n_samples;
+		if (logMessageTimeout <= 0) message.deleteMessage (INVALID_DATA_MSG);
+	}
 
-				// Pattern orientation
-				if (oFlip && (oFlip->type == uris.atom_Bool))
-				{
-					patternFlipped = ((LV2_Atom_Bool*)oFlip)->body;
-					scheduleNotifyStateChanged = true;
-				}
-			}
+	// Move reference frame in case of no new barBeat submitted on next call
+	refFrame -= n_samples;
 
-			// Sample path notification -> forward to worker
-			else if (obj->body.otype ==uris.notify_pathEvent)
-			{
-				LV2_Atom* oPath = NULL, *oStart = NULL, *oEnd = NULL, *oAmp = NULL, *oLoop = NULL;
-				lv2_atom_object_get
-				(
-					obj,
-					uris.notify_samplePath, &oPath,
-					uris.notify_sampleStart, &oStart,
-					uris.notify_sampleEnd, &oEnd,
-					uris.notify_sampleAmp, &oAmp,
-					uris.notify_sampleLoop, &oLoop,
-					NULL
-				);
-
-				// New sample
-				if (oPath && (oPath->type == uris.atom_Path))
-				{
-					workerSchedule->schedule_work (workerSchedule->handle, lv2_atom_total_size(&ev->body), &ev->body);
-				}
+	// Re-calculate waveform (monitor isn't updated while freewheeling)
+	if (freewheeling) waveformOutdated = true;
+	else if (waveformOutdated && (!waveformRequested)) requestWaveform ();
 
-				// Only start / end /amp / loop changed
-				else if (sample)
-				{
-					if (oStart && (oStart->type == uris.atom_Long)) sample->start = LIMIT (((LV2_Atom_Long*)oStart)->body, 0, sample->info.frames - 1);
-					if (oEnd && (oEnd->type == uris.atom_Long)) sample->end = LIMIT (((LV2_Atom_Long*)oEnd)->body, 0, sample->info.frames);
-					if (oAmp && (oAmp->type == uris.atom_Float)) sampleAmp = LIMIT (((LV2_Atom_Float*)oAmp)->body, 0.0f, 1.0f);
-					if (oLoop && (oLoop->type == uris.atom_Bool)) sample->loop = bool(((LV2_Atom_Bool*)oLoop)->body);
-					scheduleNotifyStateChanged = true;
-				}
-			}
+	if (controllers[PLAY] && (!freewheeling))
+	{
 
-			// Process time / position data
-			else if (obj->body.otype == uris.time_Position)
-			{
-				bool scheduleUpdatePosition = false;
-
-				// Update bpm, speed, position
-				LV2_Atom *oBbeat = NULL, *oBpm = NULL, *oSpeed = NULL, *oBpb = NULL, *oBu = NULL, *oBar = NULL;
-				const LV2_Atom_Object* obj = (const LV2_Atom_Object*)&ev->body;
-				lv2_atom_object_get
-				(
-					obj, uris.time_bar, &oBar,
-					uris.time_barBeat, &oBbeat,
-					uris.time_beatsPerMinute,  &oBpm,
-					uris.time_beatsPerBar,  &oBpb,
-					uris.time_beatUnit,  &oBu,
-					uris.time_speed, &oSpeed,
-					NULL
-				);
-
-				// BPM changed?
-				if (oBpm && (oBpm->type == uris.atom_Float) && (bpm != ((LV2_Atom_Float*)oBpm)->body))
-				{
-					bpm = ((LV2_Atom_Float*)oBpm)->body;
-					scheduleUpdatePosition = true;
-				}
+		cursor = floormod
+		(
+			getPosition (0) * controllers[NR_OF_STEPS] + controllers[STEP_OFFSET] + progressionDelay + controllers[MANUAL_PROGRSSION_DELAY],
+			controllers[NR_OF_STEPS]
+		);
+		scheduleNotifyStatusToGui = true;
+	}
 
-				// Beats per bar changed?
-				if (oBpb && (oBpb->type == uris.atom_Float) && (beatsPerBar != ((LV2_Atom_Float*)oBpb)->body))
-				{
-					beatsPerBar = ((LV2_Atom_Float*)oBpb)->body;
-					scheduleUpdatePosition = true;
-				}
+	if ((waveformCounter != lastWaveformCounter) && (!freewheeling)) scheduleNotifyWaveformToGui = true;
 
-				// BeatUnit changed?
-				if (oBu && (oBu->type == uris.atom_Int) && (beatUnit != ((LV2_Atom_Int*)oBu)->body))
-				{
-					beatUnit = ((LV2_Atom_Int*)oBu)->body;
-					scheduleUpdatePosition = true;
-				}
+	if (scheduleNotifyStateChanged) notifyStateChanged();
 
-				// Speed changed?
-				if (oSpeed && (oSpeed->type == uris.atom_Float) && (speed != ((LV2_Atom_Float*)oSpeed)->body))
-				{
-					speed = ((LV2_Atom_Float*)oSpeed)->body;
-					scheduleUpdatePosition = true;
-				}
+	// GUI notifications in order of their priority. Notifications which
+	// don't fit into the notify port are kept for the next cycle. Cursor,
+	// status and waveform are sent at GUI_UPDATE_RATE max.
+	const bool periodic = telemetry.tick (n_samples);
+	if (ui_on && (!freewheeling))
+	{
+		const uint32_t guiStart = notifyForge.offset;
+		if (padNotifications.pendingPages (nrPages)) notifyPadsToGui();
+		if (scheduleNotifySamplePathToGui) notifySamplePathToGui ();
+		if (scheduleNotifySchedulePageToGui) notifySchedulePageToGui ();
+		if (scheduleNotifyPlaybackPageToGui) notifyPlaybackPageToGui ();
+		if (scheduleNotifyMidiLearnedToGui) notifyMidiLearnedToGui ();
+		if (message.isScheduled ()) notifyMessageToGui();
+		if (periodic && scheduleNotifyStatusToGui) notifyStatusToGui();
+		if (periodic && scheduleNotifyWaveformToGui) notifyWaveformToGui (lastWaveformCounter, waveformCounter);
+		telemetry.countToGui (notifyForge.offset - guiStart);
+	}
 
-				// Bar position changed
-				if (oBar && (oBar->type == uris.atom_Long) && (bar != ((long)((LV2_Atom_Long*)oBar)->body)))
-				{
-					bar = ((LV2_Atom_Long*)oBar)->body;
-					scheduleUpdatePosition = true;
-				}
+	lv2_atom_forge_pop(&notifyForge, &notifyFrame);
 
-				// Beat position changed (during playing) ?
-				if (oBbeat && (oBbeat->type == uris.atom_Float) && (barBeat != ((LV2_Atom_Float*)oBbeat)->body))
-				{
-					barBeat = ((LV2_Atom_Float*)oBbeat)->body;
-					scheduleUpdatePosition = true;
-				}
+	if (measure) updatePerformancePorts (n_samples, PerformanceMeter::now () - runStart);
+	trace.push (TRACE_RUN_END, n_samples);
+}
 
-				if (scheduleUpdatePosition)
-				{
-					// Hard set new position if new data received
-					double pos = getPositionFromBeats (barBeat + beatsPerBar * bar);
-					position = floorfrac (pos - offset);
-					refFrame = ev->time.frames;
-					uint64_t size = getFramesFromValue (controllers[STEP_SIZE] * controllers[NR_OF_STEPS]);
-					audioBufferSize = LIMIT (size, 0, maxBufferSize);
-
-					// Store message
-					if (((bpm < 1.0) || (speed == 0.0)) && (controllers[STEP_BASE] != SECONDS)) message.setMessage (JACK_STOP_MSG);
-					else message.deleteMessage (JACK_STOP_MSG);
-				}
+/*
+ * Adds the processing time of the actual block to the performance meter
+ * and writes the performance counters to the connected ports.
+ * @param n_samples	Number of frames of the block
+ * @param runTime	Processing time of the block in ns
+ */
+void BJumblr::updatePerformancePorts (const uint32_t n_samples, const int64_t runTime)
+{
+	performanceMeter.add (runTime, int64_t (n_samples * 1000000000.0 / rate), 1000000000);
+
+	size_t memory = history->size () * history->channels () * sizeof (float);
+	if (sample && sample->data) memory += sample->info.frames * sample->info.channels * sizeof (float);
+
+	const float values[NR_PERFORMANCE_PORTS] =
+	{
+		performanceMeter.getAverage (),
+		performanceMeter.getPeak (),
+		100.0f * performanceMeter.getLoad (),
+		float (activePads),
+		100.0f * float (audioBufferSize) / float (history->size ()),
+		float (memory) / 1048576.0f,
+		telemetry.getToGuiRate (),
+		telemetry.getFromGuiRate ()
+	};
+
+	for (int i = 0; i < NR_PERFORMANCE_PORTS; ++i)
+	{
+		if (performancePorts[i]) *performancePorts[i] = values[i];
+	}
+}
+
+/*
+ * Adds a handler for control port objects of the type otype to the
+ * dispatch table.
+ * @param changesState	Handler changes state saved by state_save ()
+ */
+void BJumblr::addObjectHandler (const LV2_URID otype, const ObjectHandler handler, const bool changesState)
+{
+	for (int i = 0; i < OBJECTHANDLERSLOTS; ++i)
+	{
+		ObjectDispatch& slot = objectHandlers[(otype + i) % OBJECTHANDLERSLOTS];
+		if ((slot.otype == 0) || (slot.otype == otype))
+		{
+			slot.otype = otype;
+			slot.handler = handler;
+			slot.changesState = changesState;
+			return;
+		}
+	}
+}
+
+/*
+ * Looks up the dispatch table entry for control port objects of the type
+ * otype.
+ * @return		Entry or nullptr if no handler exists
+ */
+const BJumblr::ObjectDispatch* BJumblr::getObjectDispatch (const LV2_URID otype) const
+{
+	for (int i = 0; i < OBJECTHANDLERSLOTS; ++i)
+	{
+		const ObjectDispatch& slot = objectHandlers[(otype + i) % OBJECTHANDLERSLOTS];
+		if (slot.otype == otype) return &slot;
+		if (slot.otype == 0) return nullptr;
+	}
+	return nullptr;
+}
+
+void BJumblr::onUiOn (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	ui_on = true;
+	for (int i = 0; i < nrPages; ++i) padNotifications.markFullPattern (i);
+	statusNotified = false;
+	telemetry.force ();
+	scheduleNotifyStatusToGui = true;
+	scheduleNotifySamplePathToGui = true;
+}
+
+void BJumblr::onUiOff (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	ui_on = false;
+}
+
+/*
+ * GUI pad changed notifications
+ */
+void BJumblr::onPadEvent (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	struct
+	{
+		const LV2_Atom_Int* editMode;
+		const LV2_Atom_Int* page;
+		const LV2_Atom_Vector* pad;
+		const LV2_Atom_Vector* fullPattern;
+	} props = {nullptr, nullptr, nullptr, nullptr};
+
+	LV2_ATOM_OBJECT_FOREACH (obj, prop)
+	{
+		const LV2_Atom* value = &prop->value;
+		if ((prop->key == uris.notify_editMode) && (value->type == uris.atom_Int)) props.editMode = (const LV2_Atom_Int*) value;
+		else if ((prop->key == uris.notify_padPage) && (value->type == uris.atom_Int)) props.page = (const LV2_Atom_Int*) value;
+		else if ((prop->key == uris.notify_pad) && (value->type == uris.atom_Vector)) props.pad = (const LV2_Atom_Vector*) value;
+		else if ((prop->key == uris.notify_padFullPattern) && (value->type == uris.atom_Vector)) props.fullPattern = (const LV2_Atom_Vector*) value;
+	}
+
+	int page = -1;
+
+	// EditMode notification
+	if (props.editMode) editMode = props.editMode->body;
+
+	// padPage notification
+	if (props.page)
+	{
+		page = props.page->body;
+		if (page >= nrPages)
+		{
+			nrPages = LIMIT (page + 1, 1, MAXPAGES);
+			if (playPage >= nrPages)
+			{
+				schedulePage = nrPages - 1;
+				scheduleNotifySchedulePageToGui = true;
 			}
 		}
+	}
 
-		// Read incoming MIDI events
-		else if (ev->body.type == uris.midi_Event)
+	// Pad notification
+	if (props.pad && (page >= 0) && (page < MAXPAGES))
+	{
+		const LV2_Atom_Vector* vec = props.pad;
+		if (vec->body.child_type == uris.atom_Float)
 		{
-			const uint8_t* const msg = (const uint8_t*)(ev + 1);
-			const uint8_t status = (msg[0] >> 4);
-			const uint8_t channel = msg[0] & 0x0F;
-			const uint8_t note = ((status == 8) || (status == 9) || (status == 11) ? msg[1] : 0);
-			const uint8_t value = ((status == 8) || (status == 9) || (status == 11) ? msg[2] : 0);
+			const uint32_t size = (uint32_t) ((vec->atom.size - sizeof(LV2_Atom_Vector_Body)) / sizeof (PadMessage));
+			PadMessage* pMes = (PadMessage*) (&vec->body + 1);
 
-			if (midiLearn)
+			for (unsigned int i = 0; i < size; ++i)
 			{
-				midiLearned[0] = status;
-				midiLearned[1] = channel;
-				midiLearned[2] = note;
-				midiLearned[3] = value;
-				midiLearn = false;
-				scheduleNotifyMidiLearnedToGui = true;
+				int row = pMes[i].row;
+				int step = pMes[i].step;
+
+				// Copy PadMessages to pads
+				if ((row >= 0) && (row < MAXSTEPS) && (step >= 0) && (step < MAXSTEPS))
+				{
+					Pad pd (pMes[i].level);
+					Pad valPad = validatePad (pd);
+					pads[page][row][step] = valPad;
+					++padsVersion;
+					if (valPad != pd)
+					{
+						logMessage (LOG_PAD_OUT_OF_RANGE, page, row, step);
+						padNotifications.push (page, row, step, valPad);
+					}
+					scheduleNotifyStateChanged = true;
+				}
 			}
+		}
+	}
 
-			else
-			{
+	// Full pattern notification
+	if (props.fullPattern && (page >= 0) && (page < MAXPAGES))
+	{
+		const LV2_Atom_Vector* vec = props.fullPattern;
+		if (vec->body.child_type == uris.atom_Float)
+		{
+			const uint32_t size = (uint32_t) ((vec->atom.size - sizeof(LV2_Atom_Vector_Body)) / sizeof (Pad));
+			Pad* data = (Pad*) (&vec->body + 1);
 
-				for (int p = 0; p < nrPages; ++p)
+			if (size == MAXSTEPS * MAXSTEPS)
+			{
+				// Copy pattern data
+				for (int r = 0; r < MAXSTEPS; ++r)
 				{
-					if
-					(
-						controllers[MIDI + p * NR_MIDI_CTRLS + STATUS] &&
-						(controllers[MIDI + p * NR_MIDI_CTRLS + STATUS] == status) &&
-						(
-							(controllers[MIDI + p * NR_MIDI_CTRLS + CHANNEL] == 0) ||
-							(controllers[MIDI + p * NR_MIDI_CTRLS + CHANNEL] - 1 == channel)
-						) &&
-						(
-							(controllers[MIDI + p * NR_MIDI_CTRLS + NOTE] == 128) ||
-							(controllers[MIDI + p * NR_MIDI_CTRLS + NOTE] == note)
-						) &&
-						(
-							(controllers[MIDI + p * NR_MIDI_CTRLS + VALUE] == 128) ||
-							(controllers[MIDI + p * NR_MIDI_CTRLS + VALUE] == value)
-						)
-					)
+					for (int s = 0; s < MAXSTEPS; ++s)
 					{
-						schedulePage = p;
-						scheduleNotifySchedulePageToGui = true;
-						break;
+						pads[page][r][s] = data[r * MAXSTEPS + s];
 					}
 				}
+				++padsVersion;
+
+				scheduleNotifyStateChanged = true;
 			}
+
+			else logMessage (LOG_CORRUPT_PATTERN_SIZE, size, page);
 		}
+	}
+}
+
+/*
+ * Status notifications
+ */
+void BJumblr::onStatusEvent (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	struct
+	{
+		const LV2_Atom_Int* maxPage;
+		const LV2_Atom_Int* playbackPage;
+		const LV2_Atom_Bool* requestMidiLearn;
+		const LV2_Atom_Bool* padFlipped;
+	} props = {nullptr, nullptr, nullptr, nullptr};
+
+	LV2_ATOM_OBJECT_FOREACH (obj, prop)
+	{
+		const LV2_Atom* value = &prop->value;
+		if ((prop->key == uris.notify_maxPage) && (value->type == uris.atom_Int)) props.maxPage = (const LV2_Atom_Int*) value;
+		else if ((prop->key == uris.notify_playbackPage) && (value->type == uris.atom_Int)) props.playbackPage = (const LV2_Atom_Int*) value;
+		else if ((prop->key == uris.notify_requestMidiLearn) && (value->type == uris.atom_Bool)) props.requestMidiLearn = (const LV2_Atom_Bool*) value;
+		else if ((prop->key == uris.notify_padFlipped) && (value->type == uris.atom_Bool)) props.padFlipped = (const LV2_Atom_Bool*) value;
+	}
+
+	// padMaxPage notification
+	if (props.maxPage)
+	{
+		int newPages = props.maxPage->body;
+		if (newPages != nrPages)
+		{
+			nrPages = LIMIT (newPages, 1, MAXPAGES);
+			if (playPage >= nrPages)
+			{
+				schedulePage = nrPages - 1;
+				scheduleNotifyPlaybackPageToGui = true;
+			}
+		}
+	}
+
+	// playbackPage notification
+	if (props.playbackPage)
+	{
+		int newPp = props.playbackPage->body;
+		if (newPp != playPage)
+		{
+			playPage = LIMIT (newPp, 0, MAXPAGES - 1);
+			scheduleNotifyStateChanged = true;
+		}
+	}
+
+	// Midi learn request notification
+	if (props.requestMidiLearn) midiLearn = props.requestMidiLearn->body;
+
+	// Pattern orientation
+	if (props.padFlipped)
+	{
+		patternFlipped = props.padFlipped->body;
+		scheduleNotifyStateChanged = true;
+	}
+}
+
+/*
+ * Sample path notification -> forward to worker
+ */
+void BJumblr::onPathEvent (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	struct
+	{
+		const LV2_Atom* path;
+		const LV2_Atom_Long* start;
+		const LV2_Atom_Long* end;
+		const LV2_Atom_Float* amp;
+		const LV2_Atom_Bool* loop;
+	} props = {nullptr, nullptr, nullptr, nullptr, nullptr};
+
+	LV2_ATOM_OBJECT_FOREACH (obj, prop)
+	{
+		const LV2_Atom* value = &prop->value;
+		if ((prop->key == uris.notify_samplePath) && (value->type == uris.atom_Path)) props.path = value;
+		else if ((prop->key == uris.notify_sampleStart) && (value->type == uris.atom_Long)) props.start = (const LV2_Atom_Long*) value;
+		else if ((prop->key == uris.notify_sampleEnd) && (value->type == uris.atom_Long)) props.end = (const LV2_Atom_Long*) value;
+		else if ((prop->key == uris.notify_sampleAmp) && (value->type == uris.atom_Float)) props.amp = (const LV2_Atom_Float*) value;
+		else if ((prop->key == uris.notify_sampleLoop) && (value->type == uris.atom_Bool)) props.loop = (const LV2_Atom_Bool*) value;
+	}
+
+	// New sample
+	if (props.path)
+	{
+		scheduleWork (lv2_atom_total_size (&obj->atom), &obj->atom);
+	}
+
+	// Only start / end /amp / loop changed
+	else if (sample)
+	{
+		if (props.start) sample->start = LIMIT (props.start->body, 0, sample->info.frames - 1);
+		if (props.end) sample->end = LIMIT (props.end->body, 0, sample->info.frames);
+		if (props.amp) sampleAmp = LIMIT (props.amp->body, 0.0f, 1.0f);
+		if (props.loop) sample->loop = bool (props.loop->body);
+		scheduleNotifyStateChanged = true;
+	}
+}
+
+/*
+ * Trace export request: The worker writes the events recorded since the
+ * last request to the Chrome trace (JSON) file notify_tracePath
+ */
+void BJumblr::onTraceEvent (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	scheduleWork (lv2_atom_total_size (&obj->atom), &obj->atom);
+}
+
+/*
+ * Process time / position data
+ */
+void BJumblr::onTimePosition (const LV2_Atom_Object* obj, const int64_t frame)
+{
+	struct
+	{
+		const LV2_Atom_Long* bar;
+		const LV2_Atom_Float* barBeat;
+		const LV2_Atom_Float* bpm;
+		const LV2_Atom_Float* beatsPerBar;
+		const LV2_Atom_Int* beatUnit;
+		const LV2_Atom_Float* speed;
+	} props = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+
+	LV2_ATOM_OBJECT_FOREACH (obj, prop)
+	{
+		const LV2_Atom* value = &prop->value;
+		if ((prop->key == uris.time_bar) && (value->type == uris.atom_Long)) props.bar = (const LV2_Atom_Long*) value;
+		else if ((prop->key == uris.time_barBeat) && (value->type == uris.atom_Float)) props.barBeat = (const LV2_Atom_Float*) value;
+		else if ((prop->key == uris.time_beatsPerMinute) && (value->type == uris.atom_Float)) props.bpm = (const LV2_Atom_Float*) value;
+		else if ((prop->key == uris.time_beatsPerBar) && (value->type == uris.atom_Float)) props.beatsPerBar = (const LV2_Atom_Float*) value;
+		else if ((prop->key == uris.time_beatUnit) && (value->type == uris.atom_Int)) props.beatUnit = (const LV2_Atom_Int*) value;
+		else if ((prop->key == uris.time_speed) && (value->type == uris.atom_Float)) props.speed = (const LV2_Atom_Float*) value;
+	}
+
+	bool scheduleUpdatePosition = false;
+
+	// BPM changed?
+	if (props.bpm && (bpm != props.bpm->body))
+	{
+		bpm = props.bpm->body;
+		scheduleUpdatePosition = true;
+	}
 
-		// Update for this iteration
-		uint32_t next_t = (ev->time.frames < n_samples ? ev->time.frames : n_samples);
-		runSequencer (last_t, next_t);
-		last_t = next_t;
+	// Beats per bar changed?
+	if (props.beatsPerBar && (beatsPerBar != props.beatsPerBar->body))
+	{
+		beatsPerBar = props.beatsPerBar->body;
+		scheduleUpdatePosition = true;
 	}
 
-	// Update for the remainder of the cycle
-	if (last_t < n_samples) runSequencer (last_t, n_samples);
+	// BeatUnit changed?
+	if (props.beatUnit && (beatUnit != props.beatUnit->body))
+	{
+		beatUnit = props.beatUnit->body;
+		scheduleUpdatePosition = true;
+	}
 
-	// Update position in case of no new barBeat submitted on next call
-	double relpos = getPositionFromFrames (n_samples - refFrame);	// Position relative to reference frame
-	position = floorfrac (position + relpos);
-	refFrame = 0;
+	// Speed changed?
+	if (props.speed && (speed != props.speed->body))
+	{
+		speed = props.speed->body;
+		scheduleUpdatePosition = true;
+	}
 
-	if (controllers[PLAY])
+	// Bar position changed
+	if (props.bar && (bar != long (props.bar->body)))
 	{
+		bar = props.bar->body;
+		scheduleUpdatePosition = true;
+	}
 
-		cursor = floormod
-		(
-			position * controllers[NR_OF_STEPS] + controllers[STEP_OFFSET] + progressionDelay + controllers[MANUAL_PROGRSSION_DELAY],
-			controllers[NR_OF_STEPS]
-		);
-		scheduleNotifyStatusToGui = true;
+	// Beat position changed (during playing) ?
+	if (props.barBeat && (barBeat != props.barBeat->body))
+	{
+		barBeat = props.barBeat->body;
+		scheduleUpdatePosition = true;
 	}
 
-	if (waveformCounter != lastWaveformCounter) scheduleNotifyWaveformToGui = true;
+	if (scheduleUpdatePosition)
+	{
+		// Hard set new position if new data received
+		double pos = getPositionFromBeats (barBeat + beatsPerBar * bar);
+		position = floorfrac (pos - offset);
+		positionInc = getPositionFromFrames (1);
+		refFrame = frame;
+		updateAudioBufferSize ();
+
+		// Store message
+		if (((bpm < 1.0) || (speed == 0.0)) && (controllers[STEP_BASE] != SECONDS)) message.setMessage (JACK_STOP_MSG);
+		else message.deleteMessage (JACK_STOP_MSG);
+	}
+}
 
-	if (ui_on)
+/*
+ * Updates stateSnapshot to the current state without blocking the audio
+ * thread. Keeps the previous snapshot (including the serialized pads) if
+ * the state didn't change since. Non-RT.
+ * @return	False if the snapshot can't be allocated
+ */
+bool BJumblr::updateStateSnapshot ()
+{
+	if (!stateSnapshot)
 	{
-		if (scheduleNotifyStatusToGui) notifyStatusToGui();
-		if (scheduleNotifyPadsToGui) notifyPadsToGui();
-		if (scheduleNotifyWaveformToGui) notifyWaveformToGui (lastWaveformCounter, waveformCounter);
-		if (scheduleNotifySamplePathToGui) notifySamplePathToGui ();
-		if (scheduleNotifySchedulePageToGui) notifySchedulePageToGui ();
-		if (scheduleNotifyPlaybackPageToGui) notifyPlaybackPageToGui ();
-		if (scheduleNotifyMidiLearnedToGui) notifyMidiLearnedToGui ();
-		if (message.isScheduled ()) notifyMessageToGui();
+		try {stateSnapshot = new StateSnapshot ();}
+		catch (std::bad_alloc &ba) {return false;}
+		stateSnapshot->valid = false;
 	}
 
-	if (scheduleNotifyStateChanged) notifyStateChanged();
-	lv2_atom_forge_pop(&notifyForge, &notifyFrame);
+	StateSnapshot* ss = stateSnapshot;
+
+	// Samples and pattern sets replaced in the meantime mustn't be freed
+	// while they are copied
+	std::lock_guard<std::mutex> lock (freeMutex);
+
+	uint32_t seq;
+	do
+	{
+		seq = stateLock.beginRead ();
+		if (ss->valid && (ss->sequence == seq)) return true;
+
+		const int pages = LIMIT (nrPages, 1, MAXPAGES);
+		memcpy (ss->patterns.pads, pads, pages * sizeof (ss->patterns.pads[0]));
+		ss->patterns.nrPages = pages;
+		ss->patterns.playPage = playPage;
+		ss->patterns.editMode = editMode;
+		ss->patterns.patternFlipped = patternFlipped;
+
+		const Sample* s = sample;
+		ss->samplePath[0] = 0;
+		if (s && s->path && (s->path[0] != 0) && (controllers[SOURCE] == 1.0))
+		{
+			strncpy (ss->samplePath, s->path, PATH_MAX - 1);
+			ss->samplePath[PATH_MAX - 1] = 0;
+			ss->sampleStart = s->start;
+			ss->sampleEnd = s->end;
+			ss->sampleLoop = s->loop;
+		}
+		ss->sampleAmp = sampleAmp;
+	} while (stateLock.retry (seq));
+
+	// Encode pads
+	encodePatternChunk (ss->patterns.pads, ss->patterns.nrPages, ss->padData);
+
+	ss->sequence = seq;
+	ss->valid = true;
+	return true;
 }
 
 LV2_State_Status BJumblr::state_save (LV2_State_Store_Function store, LV2_State_Handle handle, uint32_t flags,
 			const LV2_Feature* const* features)
 {
+	// Take a consistent copy of the state
+	if (!updateStateSnapshot ())
+	{
+		fprintf (stderr, "BJumblr.lv2: Can't allocate enough memory to save the state.\n");
+		return LV2_STATE_ERR_UNKNOWN;
+	}
+
+	const StateSnapshot* ss = stateSnapshot;
+
 	// Store sample path
-	if (sample && sample->path && (sample->path[0] != 0) && (controllers[SOURCE] == 1.0))
+	if (ss->samplePath[0] != 0)
 	{
 		LV2_State_Map_Path* mapPath = NULL;
 #ifdef LV2_STATE__freePath
@@ -834,16 +1593,16 @@ LV2_State_Status BJumblr::state_save (LV2_State_Store_Function store, LV2_State_
 
 		if (mapPath)
 		{
-			char* abstrPath = mapPath->abstract_path(mapPath->handle, sample->path);
+			char* abstrPath = mapPath->abstract_path(mapPath->handle, ss->samplePath);
 
 			if (abstrPath)
 			{
 				fprintf(stderr, "BJumblr.lv2: Save abstr_path:%s\n", abstrPath);
 				store(handle, uris.notify_samplePath, abstrPath, strlen (abstrPath) + 1, uris.atom_Path, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
-				store(handle, uris.notify_sampleStart, &sample->start, sizeof (sample->start), uris.atom_Long, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
-				store(handle, uris.notify_sampleEnd, &sample->end, sizeof (sample->end), uris.atom_Long, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
-				store(handle, uris.notify_sampleAmp, &sampleAmp, sizeof (sampleAmp), uris.atom_Float, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
-				const int32_t sloop = int32_t (sample->loop);
+				store(handle, uris.notify_sampleStart, &ss->sampleStart, sizeof (ss->sampleStart), uris.atom_Long, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+				store(handle, uris.notify_sampleEnd, &ss->sampleEnd, sizeof (ss->sampleEnd), uris.atom_Long, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+				store(handle, uris.notify_sampleAmp, &ss->sampleAmp, sizeof (ss->sampleAmp), uris.atom_Float, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+				const int32_t sloop = int32_t (ss->sampleLoop);
 				store(handle, uris.notify_sampleLoop, &sloop, sizeof (sloop), uris.atom_Bool, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 
 #ifdef LV2_STATE__freePath
@@ -855,7 +1614,7 @@ LV2_State_Status BJumblr::state_save (LV2_State_Store_Function store, LV2_State_
 				}
 			}
 
-			else fprintf(stderr, "BJumblr.lv2: Can't generate abstr_path from %s\n", sample->path);
+			else fprintf(stderr, "BJumblr.lv2: Can't generate abstr_path from %s\n", ss->samplePath);
 		}
 		else
 		{
@@ -865,39 +1624,19 @@ LV2_State_Status BJumblr::state_save (LV2_State_Store_Function store, LV2_State_
 	}
 
 	// Store pattern orientation
-	store(handle, uris.notify_padFlipped, &patternFlipped, sizeof (patternFlipped), uris.atom_Bool, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+	const bool flipped = (ss->patterns.patternFlipped > 0);
+	store(handle, uris.notify_padFlipped, &flipped, sizeof (flipped), uris.atom_Bool, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 
 	// Store playbackPage
-	uint32_t pp = playPage;
+	uint32_t pp = ss->patterns.playPage;
 	store (handle, uris.notify_playbackPage, &pp, sizeof(uint32_t), uris.atom_Int, LV2_STATE_IS_POD);
 
 	// Store edit mode
-	uint32_t em = editMode;
+	uint32_t em = ss->patterns.editMode;
 	store (handle, uris.notify_editMode, &em, sizeof(uint32_t), uris.atom_Int, LV2_STATE_IS_POD);
 
 	// Store pads
-	char padDataString[0x80100] = "\nMatrix data:\n";
-
-	for (int page = 0; page < nrPages; ++page)
-	{
-		for (int step = 0; step < MAXSTEPS; ++step)
-		{
-			for (int row = 0; row < MAXSTEPS; ++row)
-			{
-				Pad* pd = &pads[page][row][step];
-				if (*pd != Pad())
-				{
-					char valueString[64];
-					int id = step * MAXSTEPS + row;
-					snprintf (valueString, 62, "pg:%d; id:%d; lv:%f", page, id, pd->level);
-					if ((step < MAXSTEPS - 1) || (row < MAXSTEPS)) strcat (valueString, ";\n");
-					else strcat(valueString, "\n");
-					strcat (padDataString, valueString);
-				}
-			}
-		}
-	}
-	store (handle, uris.state_pad, padDataString, strlen (padDataString) + 1, uris.atom_String, LV2_STATE_IS_POD);
+	store (handle, uris.state_patternChunk, ss->padData.data (), ss->padData.size (), uris.atom_Chunk, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 
 	return LV2_STATE_SUCCESS;
 }
@@ -1008,6 +1747,8 @@ LV2_State_Status BJumblr::state_restore (LV2_State_Retrieve_Function retrieve, L
 
 		else
 		{
+			stateLock.beginWrite ();
+
 			// Free old sample
 			if (sample)
 			{
@@ -1039,16 +1780,26 @@ LV2_State_Status BJumblr::state_restore (LV2_State_Retrieve_Function retrieve, L
 				this->sampleAmp = sampleAmp;
 			}
 
+			stateLock.endWrite ();
 			scheduleNotifySamplePathToGui = true;
 		}
 	}
 
+	// Build a new pattern set, installed by run () (or immediately if not
+	// activated)
+	PatternSet* ps;
+	try {ps = new PatternSet ();}
+	catch (std::bad_alloc &ba)
+	{
+		fprintf (stderr, "BJumblr.lv2: Can't allocate enough memory to restore the pattern.\n");
+		return LV2_STATE_ERR_UNKNOWN;
+	}
+
 	// Retrieve pattern orientation
 	const void* flipData = retrieve (handle, uris.notify_padFlipped, &size, &type, &valflags);
         if (flipData && (type == uris.atom_Bool))
 	{
-		patternFlipped = *(bool*) flipData;
-		scheduleNotifyStatusToGui = true;
+		ps->patternFlipped = *(bool*) flipData;
         }
 
 	// Retrieve playbackPage
@@ -1057,8 +1808,7 @@ LV2_State_Status BJumblr::state_restore (LV2_State_Retrieve_Function retrieve, L
 	{
 		const uint32_t pp = *(const uint32_t*) ppData;
 		if ((pp < 0) || (pp >= MAXPAGES)) fprintf (stderr, "BJumblr.lv2: Invalid playbackPage data\n");
-		else playPage = pp;
-		scheduleNotifyPlaybackPageToGui = true;
+		else ps->playPage = pp;
         }
 
 	// Retrieve edit mode
@@ -1067,136 +1817,72 @@ LV2_State_Status BJumblr::state_restore (LV2_State_Retrieve_Function retrieve, L
 	{
 		const uint32_t mode = *(const uint32_t*) modeData;
 		if ((mode < 0) || (mode > 1)) fprintf (stderr, "BJumblr.lv2: Invalid editMode data\n");
-		else editMode = mode;
+		else ps->editMode = mode;
         }
 
-	// Retrieve pad data
+	// Retrieve pad data, binary chunk or legacy text
+	size_t chunkSize;
+	uint32_t chunkType;
+	const void* chunkData = retrieve (handle, uris.state_patternChunk, &chunkSize, &chunkType, &valflags);
 	const void* padData = retrieve(handle, uris.state_pad, &size, &type, &valflags);
 
-	if (padData && (type == uris.atom_String))
+	if (chunkData && (chunkType == uris.atom_Chunk))
 	{
-		nrPages = 1;
-		for (int i = 0; i < MAXPAGES; ++i)
-		{
-			for (int j = 0; j < MAXSTEPS; ++j)
-			{
-				for (int k = 0; k < MAXSTEPS; ++k)
-				{
-					pads[i][j][k] = Pad();
-				}
-			}
-		}
-
-		std::string padDataString = (char*) padData;
-		const std::string keywords[3] = {"pg:", "id:", "lv:"};
-
-		// Restore pads
-		// Parse retrieved data
-		while (!padDataString.empty())
+		if (decodePatternChunk ((const uint8_t*) chunkData, chunkSize, ps->pads, ps->nrPages)) ps->padsRestored = true;
+		else
 		{
-			// Look for optional "pg:"
-			int page = 0;
-			size_t strPos = padDataString.find (keywords[0]);
-			size_t nextPos = 0;
-			if ((strPos != std::string::npos) && (strPos + 3 <= padDataString.length()))
-			{
-				padDataString.erase (0, strPos + 3);
-				int p;
-				try {p = std::stof (padDataString, &nextPos);}
-				catch  (const std::exception& e)
-				{
-					fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Can't parse page from \"%s...\"", padDataString.substr (0, 63).c_str());
-					break;
-				}
-
-				if (nextPos > 0) padDataString.erase (0, nextPos);
-				if ((p < 0) || (p >= MAXPAGES))
-				{
-					fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Invalid matrix data block loaded with page %i. Try to use the data before this page.\n", p);
-					break;
-				}
-				if (p >= nrPages) nrPages = p + 1;
-				page = p;
-			}
-
-			// Look for "id:"
-			strPos = padDataString.find (keywords[1]);
-			nextPos = 0;
-			if (strPos == std::string::npos) break;	// No "id:" found => end
-			if (strPos + 3 > padDataString.length()) break;	// Nothing more after id => end
-			padDataString.erase (0, strPos + 3);
-			int id;
-			try {id = std::stof (padDataString, &nextPos);}
-			catch  (const std::exception& e)
-			{
-				fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Can't parse ID from \"%s...\"", padDataString.substr (0, 63).c_str());
-				break;
-			}
-
-			if (nextPos > 0) padDataString.erase (0, nextPos);
-			if ((id < 0) || (id >= MAXSTEPS * MAXSTEPS))
-			{
-				fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Invalid matrix data block loaded with ID %i. Try to use the data before this id.\n", id);
-				break;
-			}
-			int row = id % MAXSTEPS;
-			int step = id / MAXSTEPS;
-
-			// Look for pad data
-			for (int i = 2; i < 3; ++i)
+			// Discard the partially decoded pattern and fall back to the text
+			fprintf (stderr, "BJumblr.lv2: Invalid pattern data chunk.%s\n", (padData && (type == uris.atom_String)) ? " Try pattern text." : " Pattern not restored.");
+			for (int p = 0; p < MAXPAGES; ++p)
 			{
-				strPos = padDataString.find (keywords[i]);
-				if (strPos == std::string::npos) continue;	// Keyword not found => next keyword
-				if (strPos + 3 >= padDataString.length())	// Nothing more after keyword => end
-				{
-					padDataString ="";
-					break;
-				}
-				if (strPos > 0) padDataString.erase (0, strPos + 3);
-				float val;
-				try {val = std::stof (padDataString, &nextPos);}
-				catch  (const std::exception& e)
+				for (int r = 0; r < MAXSTEPS; ++r)
 				{
-					fprintf (stderr, "BJumblr.lv2: Restore padstate incomplete. Can't parse %s from \"%s...\"",
-							 keywords[i].substr(0,2).c_str(), padDataString.substr (0, 63).c_str());
-					break;
-				}
-
-				if (nextPos > 0) padDataString.erase (0, nextPos);
-				switch (i) {
-				case 2:	pads[page][row][step].level = val;
-					break;
-				default:break;
+					for (int s = 0; s < MAXSTEPS; ++s) ps->pads[p][r][s] = Pad ();
 				}
 			}
 		}
+	}
 
+	if ((!ps->padsRestored) && padData && (type == uris.atom_String))
+	{
+		ps->padsRestored = true;
+		parsePatternText ((const char*) padData, ps->pads, ps->nrPages);
+	}
 
-		// Validate all pads
-		for (int p = 0; p < nrPages; ++p)
+	// Validate all pads
+	if (ps->padsRestored)
+	{
+		for (int p = 0; p < ps->nrPages; ++p)
 		{
 			for (int i = 0; i < MAXSTEPS; ++i)
 			{
 				for (int j = 0; j < MAXSTEPS; ++j)
 				{
-					Pad valPad = validatePad (pads[p][i][j]);
-					if (valPad != pads[p][i][j])
+					Pad valPad = validatePad (ps->pads[p][i][j]);
+					if (valPad != ps->pads[p][i][j])
 					{
 						fprintf (stderr, "BJumblr.lv2: Pad out of range in state_restore (): pads[%i][%i][%i].\n", p, i, j);
-						pads[p][i][j] = valPad;
+						ps->pads[p][i][j] = valPad;
 					}
 				}
 			}
-
-			scheduleNotifyFullPatternToGui[p] = true;
 		}
+	}
 
-		// Force GUI notification
-		scheduleNotifyPadsToGui = true;
+	// Publish the new pattern set. Replaces a set not yet installed by run ().
+	if (activated)
+	{
+		PatternSet* pending = restoredPatterns.exchange (ps, std::memory_order_acq_rel);
+		if (pending) delete pending;
 	}
 
-	// Force GUI notification
-	scheduleNotifyStatusToGui = true;
+	else
+	{
+		stateLock.beginWrite ();
+		PatternSet* old = installPatterns (ps);
+		stateLock.endWrite ();
+		if (old) delete old;
+	}
 
 	return LV2_STATE_SUCCESS;
 }
@@ -1210,9 +1896,110 @@ LV2_Worker_Status BJumblr::work (LV2_Worker_Respond_Function respond, LV2_Worker
         if (atom->type == uris.notify_sampleFreeEvent)
 	{
 		const WorkerMessage* workerMessage = (WorkerMessage*) atom;
+		std::lock_guard<std::mutex> lock (freeMutex);
 		if (workerMessage->sample) delete workerMessage->sample;
         }
 
+	// Compile pads
+	else if (atom->type == uris.notify_buildSchedule)
+	{
+		const ScheduleMessage* scheduleMessage = (const ScheduleMessage*) atom;
+		scheduleMessage->schedule->build (scheduleMessage->patterns->pads, scheduleMessage->nrOfSteps, scheduleMessage->version);
+		ScheduleMessage response = *scheduleMessage;
+		response.atom.type = uris.notify_installSchedule;
+		respond (handle, sizeof (response), &response);
+	}
+
+	// Allocate and fill a resized history
+	else if (atom->type == uris.notify_resizeHistory)
+	{
+		const HistoryMessage* historyMessage = (const HistoryMessage*) atom;
+		FrameRing* h = nullptr;
+		try {h = new FrameRing (nrChannels, historyMessage->size);}
+		catch (std::bad_alloc &ba)
+		{
+			fprintf (stderr, "BJumblr.lv2: Can't allocate enough memory to resize the audio buffer.\n");
+
+			// Respond without history, run () retries later
+			HistoryMessage response = *historyMessage;
+			response.atom.type = uris.notify_installHistory;
+			response.history = nullptr;
+			respond (handle, sizeof (response), &response);
+			return LV2_WORKER_ERR_NO_SPACE;
+		}
+
+		// Copy the history up to the audio buffer position at request time.
+		// Frames written by run () in the meantime are patched in
+		// work_response (). As run () keeps writing to the old ring, the
+		// oldest frames of this copy may be overwritten while they are
+		// copied. work_response () discards them.
+		h->copyHistory (*historyMessage->history, historyMessage->counter);
+
+		HistoryMessage response = *historyMessage;
+		response.atom.type = uris.notify_installHistory;
+		response.history = h;
+		respond (handle, sizeof (response), &response);
+	}
+
+	// Re-calculate waveform
+	else if (atom->type == uris.notify_buildWaveform)
+	{
+		const WaveformMessage* waveformMessage = (const WaveformMessage*) atom;
+		const FrameRing* h = waveformMessage->history;
+		const size_t size = waveformMessage->size;
+
+		for (size_t i = 0; i < WAVEFORMSIZE; ++i)
+		{
+			double di = double (i) / WAVEFORMSIZE;
+			int wcount = size_t ((waveformMessage->position + di) * WAVEFORMSIZE) % WAVEFORMSIZE;
+
+			// Min/max envelope of all frames of the slot
+			const size_t f0 = (i * size) / WAVEFORMSIZE;
+			const size_t f1 = std::max (((i + 1) * size) / WAVEFORMSIZE, f0 + 1);
+			EnvelopeSlot slot = {0.0f, 0.0f};
+			for (size_t f = f0; f < f1; ++f)
+			{
+				const float* frame = h->frame (h->size () + waveformMessage->counter - size + f);
+				float sum = 0.0f;
+				for (int c = 0; c < nrChannels; ++c) sum += frame[c];
+				const float value = sum / nrChannels;
+				if (f == f0) slot = EnvelopeSlot {value, value};
+				else
+				{
+					slot.min = std::min (slot.min, value);
+					slot.max = std::max (slot.max, value);
+				}
+			}
+			waveformBuffer[wcount] = slot;
+		}
+
+		WaveformMessage response = *waveformMessage;
+		response.atom.type = uris.notify_installWaveform;
+		respond (handle, sizeof (response), &response);
+	}
+
+	// Print log messages
+	else if (atom->type == uris.notify_drainLog)
+	{
+		rtLog.drain (stderr);
+		respond (handle, size, data);
+	}
+
+	// Free replaced pattern set
+	else if (atom->type == uris.notify_patternFreeEvent)
+	{
+		const PatternMessage* patternMessage = (const PatternMessage*) atom;
+		std::lock_guard<std::mutex> lock (freeMutex);
+		if (patternMessage->patterns) delete patternMessage->patterns;
+	}
+
+	// Free old history
+	else if (atom->type == uris.notify_historyFreeEvent)
+	{
+		const HistoryMessage* historyMessage = (const HistoryMessage*) atom;
+		if (historyMessage->history) delete historyMessage->history;
+	}
+
 	// Load sample
 	else
 	{
@@ -1234,19 +2021,20 @@ LV2_Worker_Status BJumblr::work (LV2_Worker_Respond_Function respond, LV2_Worker
 
 			if (path && (path->type == uris.atom_Path))
 			{
-				message.deleteMessage (CANT_OPEN_SAMPLE);
+				// Messages are owned by the audio thread: Report failures via work_response
+				const LV2_Atom_Int failed = {{sizeof (int32_t), uris.notify_messageEvent}, CANT_OPEN_SAMPLE};
 				Sample* s = nullptr;
 				try {s = new Sample ((const char*)LV2_ATOM_BODY_CONST(path));}
 				catch (std::bad_alloc &ba)
 				{
 					fprintf (stderr, "BJumblr.lv2: Can't allocate enough memory to open sample file.\n");
-					message.setMessage (CANT_OPEN_SAMPLE);
+					respond (handle, sizeof (failed), &failed);
 					return LV2_WORKER_ERR_NO_SPACE;
 				}
 				catch (std::invalid_argument &ia)
 				{
 					fprintf (stderr, "%s\n", ia.what());
-					message.setMessage (CANT_OPEN_SAMPLE);
+					respond (handle, sizeof (failed), &failed);
 					return LV2_WORKER_ERR_UNKNOWN;
 				}
 
@@ -1261,7 +2049,24 @@ LV2_Worker_Status BJumblr::work (LV2_Worker_Respond_Function respond, LV2_Worker
 					sAtom.loop = (oLoop && (oLoop->type == uris.atom_Bool) ? ((LV2_Atom_Bool*)oLoop)->body : 0);
 					respond (handle, sizeof(sAtom), &sAtom);
 				}
-				if (s) respond (handle, sizeof(s), &s);
+			}
+
+			else return LV2_WORKER_ERR_UNKNOWN;
+		}
+
+		// Export trace
+		else if (obj->body.otype == uris.notify_traceEvent)
+		{
+			const LV2_Atom* path = NULL;
+			lv2_atom_object_get (obj, uris.notify_tracePath, &path, 0);
+
+			if (path && (path->type == uris.atom_Path))
+			{
+				if (!trace.writeChromeTrace ((const char*)LV2_ATOM_BODY_CONST(path)))
+				{
+					fprintf (stderr, "BJumblr.lv2: Can't write trace file %s.\n", (const char*)LV2_ATOM_BODY_CONST(path));
+					return LV2_WORKER_ERR_UNKNOWN;
+				}
 			}
 
 			else return LV2_WORKER_ERR_UNKNOWN;
@@ -1276,14 +2081,16 @@ LV2_Worker_Status BJumblr::work_response (uint32_t size, const void* data)
 	const LV2_Atom* atom = (const LV2_Atom*)data;
 	if (!atom) return LV2_WORKER_ERR_UNKNOWN;
 
+	trace.push (TRACE_WORK_RESPONSE, atom->type);
+
 	if (atom->type == uris.notify_installSample)
 	{
 		const WorkerMessage* nAtom = (const WorkerMessage*)data;
-		// Schedule worker to free old sample
-		WorkerMessage sAtom = {{sizeof (Sample*), uris.notify_sampleFreeEvent}, sample};
-		workerSchedule->schedule_work (workerSchedule->handle, sizeof (sAtom), &sAtom);
 
 		// Install new sample from data
+		message.deleteMessage (CANT_OPEN_SAMPLE);
+		stateLock.beginWrite ();
+		Sample* oldSample = sample;
 		sample = nAtom->sample;
 		if (sample)
 		{
@@ -1291,6 +2098,16 @@ LV2_Worker_Status BJumblr::work_response (uint32_t size, const void* data)
 			sample->end = LIMIT (nAtom->end, sample->start, sample->info.frames);
 			sampleAmp = LIMIT (nAtom->amp, 0.0f, 1.0f);
 			sample->loop = bool (nAtom->loop);
+		}
+		stateLock.endWrite ();
+
+		// Schedule worker to free old sample. Not before the new one is
+		// published, readers of the state snapshot may still use it.
+		WorkerMessage sAtom = {{sizeof (Sample*), uris.notify_sampleFreeEvent}, oldSample};
+		scheduleWork (sizeof (sAtom), &sAtom);
+
+		if (sample)
+		{
 			scheduleNotifyStateChanged = true;
 			return LV2_WORKER_SUCCESS;
 		}
@@ -1302,6 +2119,67 @@ LV2_Worker_Status BJumblr::work_response (uint32_t size, const void* data)
 		}
 	}
 
+	else if (atom->type == uris.notify_installSchedule)
+	{
+		const ScheduleMessage* scheduleMessage = (const ScheduleMessage*) atom;
+		padSchedule = scheduleMessage->schedule;
+		padScheduleRequested = false;
+		return LV2_WORKER_SUCCESS;
+	}
+
+	else if (atom->type == uris.notify_installWaveform)
+	{
+		std::copy (waveformBuffer, waveformBuffer + WAVEFORMSIZE, waveform);
+		waveformRequested = false;
+
+		// Notify full waveform
+		lastWaveformCounter = -1;
+		scheduleNotifyWaveformToGui = true;
+		return LV2_WORKER_SUCCESS;
+	}
+
+	else if ((atom->type == uris.notify_messageEvent) && (atom->size == sizeof (int32_t)))
+	{
+		message.setMessage (MessageNr (((const LV2_Atom_Int*) atom)->body));
+		return LV2_WORKER_SUCCESS;
+	}
+
+	else if (atom->type == uris.notify_drainLog)
+	{
+		logDrainRequested = false;
+		return LV2_WORKER_SUCCESS;
+	}
+
+	else if (atom->type == uris.notify_installHistory)
+	{
+		const HistoryMessage* historyMessage = (const HistoryMessage*) atom;
+		FrameRing* h = historyMessage->history;
+
+		// Allocation failed: Retry later
+		if (!h)
+		{
+			message.setMessage (OUT_OF_MEMORY_MSG);
+			historyRetryTimeout = HISTORY_RETRY_TIME * rate;
+			historyRequested = false;
+			return LV2_WORKER_ERR_NO_SPACE;
+		}
+
+		// Patch frames written since the request and discard torn frames
+		h->patchHistory (*history, historyMessage->counter, audioBufferCounter);
+		message.deleteMessage (OUT_OF_MEMORY_MSG);
+
+		// Schedule worker to free old history
+		HistoryMessage fAtom = *historyMessage;
+		fAtom.atom.type = uris.notify_historyFreeEvent;
+		fAtom.history = history;
+		scheduleWork (sizeof (fAtom), &fAtom);
+
+		history = h;
+		historyRequested = false;
+		updateAudioBufferSize ();
+		return LV2_WORKER_SUCCESS;
+	}
+
 	else return LV2_WORKER_ERR_UNKNOWN;
 }
 
@@ -1326,26 +2204,6 @@ Pad BJumblr::validatePad (Pad pad)
 	return Pad(validateValue (pad.level, {0, 1, 0}));
 }
 
-/*
- * Appends a single pad to padMessageBuffer
- */
-bool BJumblr::padMessageBufferAppendPad (int page, int row, int step, Pad pad)
-{
-	PadMessage end = PadMessage (ENDPADMESSAGE);
-	PadMessage msg = PadMessage (step, row, pad.level);
-
-	for (int i = 0; i < MAXSTEPS * MAXSTEPS; ++i)
-	{
-		if (padMessageBuffer[page][i] != end)
-		{
-			padMessageBuffer[page][i] = msg;
-			if (i < MAXSTEPS * MAXSTEPS - 1) padMessageBuffer[page][i + 1] = end;
-			return true;
-		}
-	}
-	return false;
-}
-
 LV2_Atom_Forge_Ref BJumblr::forgeSamplePath (LV2_Atom_Forge* forge, LV2_Atom_Forge_Frame* frame, const char* path, const int64_t start, const int64_t end, const float amp, const int32_t loop)
 {
 	const LV2_Atom_Forge_Ref msg = lv2_atom_forge_object (forge, frame, 0, uris.notify_pathEvent);
@@ -1365,12 +2223,30 @@ LV2_Atom_Forge_Ref BJumblr::forgeSamplePath (LV2_Atom_Forge* forge, LV2_Atom_For
 	return msg;
 }
 
-void BJumblr::notifyPadsToGui ()
+/*
+ * @param size	Size of a notification object in bytes
+ * @return	True if an event with the object fits into the notify port
+ */
+bool BJumblr::notifySpace (const uint32_t size) const
 {
-	PadMessage endmsg (ENDPADMESSAGE);
+	return (notifyForge.offset + sizeof (int64_t) + lv2_atom_pad_size (size) <= notifyForge.size);
+}
 
+void BJumblr::notifyPadsToGui ()
+{
+	// Only pages with changed pads
+	const uint32_t pages = padNotifications.pendingPages (nrPages);
 	for (int p = 0; p < nrPages; ++p)
 	{
+		if (!(pages & (1u << p))) continue;
+
+		const uint32_t dataSize =
+		(
+			padNotifications.isFullPattern (p) ?
+			MAXSTEPS * MAXSTEPS * sizeof (Pad) :
+			padNotifications.size (p) * sizeof (PadMessage)
+		);
+		if (!notifySpace (notifyObjectSize (2, dataSize))) break;
 
 		LV2_Atom_Forge_Frame frame;
 		lv2_atom_forge_frame_time(&notifyForge, 0);
@@ -1380,85 +2256,96 @@ void BJumblr::notifyPadsToGui ()
 		lv2_atom_forge_key(&notifyForge, uris.notify_padPage);
 		lv2_atom_forge_int(&notifyForge, p);
 
-		if (scheduleNotifyFullPatternToGui[p])
+		if (padNotifications.isFullPattern (p))
 		{
 			lv2_atom_forge_key(&notifyForge, uris.notify_padFullPattern);
 			lv2_atom_forge_vector(&notifyForge, sizeof(float), uris.atom_Float, MAXSTEPS * MAXSTEPS * sizeof(Pad) / sizeof(float), (void*) &pads[p]);
 		}
 
-		else if (!(endmsg == padMessageBuffer[p][0]))
+		else
 		{
-
-			// Get padMessageBuffer size
-			int end = 0;
-			for (int i = 0; (i < MAXSTEPS * MAXSTEPS) && (!(padMessageBuffer[p][i] == endmsg)); ++i) end = i;
-
 			lv2_atom_forge_key(&notifyForge, uris.notify_pad);
-			lv2_atom_forge_vector(&notifyForge, sizeof(float), uris.atom_Float, sizeof(PadMessage) / sizeof(float) * (end + 1), (void*) &padMessageBuffer[p]);
+			lv2_atom_forge_vector(&notifyForge, sizeof(float), uris.atom_Float, sizeof(PadMessage) / sizeof(float) * padNotifications.size (p), (void*) padNotifications.data (p));
 		}
 
 		lv2_atom_forge_pop(&notifyForge, &frame);
 
-		// Empty padMessageBuffer
-		padMessageBuffer[p][0] = endmsg;
-
-		scheduleNotifyFullPatternToGui[p] = false;
+		padNotifications.clear (p);
 	}
-
-	scheduleNotifyPadsToGui = false;
 }
 
 void BJumblr::notifyStatusToGui ()
 {
-	// Prepare forge buffer and initialize atom sequence
-	LV2_Atom_Forge_Frame frame;
-	lv2_atom_forge_frame_time(&notifyForge, 0);
-	lv2_atom_forge_object(&notifyForge, &frame, 0, uris.notify_statusEvent);
-	lv2_atom_forge_key(&notifyForge, uris.notify_cursor);
-	lv2_atom_forge_float(&notifyForge, cursor);
-	float delay = progressionDelay + controllers[MANUAL_PROGRSSION_DELAY];
-	lv2_atom_forge_key(&notifyForge, uris.notify_progressionDelay);
-	lv2_atom_forge_float(&notifyForge, delay);
-	lv2_atom_forge_key(&notifyForge, uris.notify_padFlipped);
-	lv2_atom_forge_bool(&notifyForge, patternFlipped);
-	lv2_atom_forge_pop(&notifyForge, &frame);
+	// Only changed fields
+	const float delay = progressionDelay + controllers[MANUAL_PROGRSSION_DELAY];
+	const bool cursorChanged = ((!statusNotified) || (cursor != notifiedCursor));
+	const bool delayChanged = ((!statusNotified) || (delay != notifiedDelay));
+	const bool flipChanged = ((!statusNotified) || (patternFlipped != notifiedFlipped));
+
+	if (cursorChanged || delayChanged || flipChanged)
+	{
+		if (!notifySpace (notifyObjectSize (3))) return;
+
+		LV2_Atom_Forge_Frame frame;
+		lv2_atom_forge_frame_time(&notifyForge, 0);
+		lv2_atom_forge_object(&notifyForge, &frame, 0, uris.notify_statusEvent);
+		if (cursorChanged)
+		{
+			lv2_atom_forge_key(&notifyForge, uris.notify_cursor);
+			lv2_atom_forge_float(&notifyForge, cursor);
+		}
+		if (delayChanged)
+		{
+			lv2_atom_forge_key(&notifyForge, uris.notify_progressionDelay);
+			lv2_atom_forge_float(&notifyForge, delay);
+		}
+		if (flipChanged)
+		{
+			lv2_atom_forge_key(&notifyForge, uris.notify_padFlipped);
+			lv2_atom_forge_bool(&notifyForge, patternFlipped);
+		}
+		lv2_atom_forge_pop(&notifyForge, &frame);
+
+		notifiedCursor = cursor;
+		notifiedDelay = delay;
+		notifiedFlipped = patternFlipped;
+		statusNotified = true;
+	}
 
 	scheduleNotifyStatusToGui = false;
 }
 
+/*
+ * Notifies the GUI about the min/max envelope of the waveform slots from
+ * start to end (inclusive, wraps around) as a single quantized chunk.
+ * @param start		First slot or -1 for the full waveform
+ * @param end		Last slot
+ */
 void BJumblr::notifyWaveformToGui (const int start, const int end)
 {
-	int p1 = (start <= end ? end : WAVEFORMSIZE - 1);
+	const int first = (start >= 0 ? start : (end + 1) % WAVEFORMSIZE);
+	const int size = (end - first + WAVEFORMSIZE) % WAVEFORMSIZE + 1;
+	const uint32_t chunkSize = getWaveformEnvelopeSize (size, WAVEFORM_BITS);
+	if (!notifySpace (notifyObjectSize (0, chunkSize))) return;
+
+	encodeWaveformEnvelope (waveform, first, size, WAVEFORM_BITS, waveformTransport);
 
-	// Notify shapeBuffer (position to end)
 	LV2_Atom_Forge_Frame frame;
 	lv2_atom_forge_frame_time(&notifyForge, 0);
 	lv2_atom_forge_object(&notifyForge, &frame, 0, uris.notify_waveformEvent);
-	lv2_atom_forge_key(&notifyForge, uris.notify_waveformStart);
-	lv2_atom_forge_int(&notifyForge, start);
-	lv2_atom_forge_key(&notifyForge, uris.notify_waveformData);
-	lv2_atom_forge_vector(&notifyForge, sizeof(float), uris.atom_Float, (uint32_t) (p1 + 1 - start), &waveform[start]);
+	lv2_atom_forge_key(&notifyForge, uris.notify_waveformEnvelope);
+	lv2_atom_forge_atom(&notifyForge, chunkSize, uris.atom_Chunk);
+	lv2_atom_forge_write(&notifyForge, waveformTransport, chunkSize);
 	lv2_atom_forge_pop(&notifyForge, &frame);
 
-	// Additional notification if position exceeds end
-	if (start > waveformCounter)
-	{
-		LV2_Atom_Forge_Frame frame;
-		lv2_atom_forge_frame_time(&notifyForge, 0);
-		lv2_atom_forge_object(&notifyForge, &frame, 0, uris.notify_waveformEvent);
-		lv2_atom_forge_key(&notifyForge, uris.notify_waveformStart);
-		lv2_atom_forge_int(&notifyForge, 0);
-		lv2_atom_forge_key(&notifyForge, uris.notify_waveformData);
-		lv2_atom_forge_vector(&notifyForge, sizeof(float), uris.atom_Float, (uint32_t) (end), &waveform[0]);
-		lv2_atom_forge_pop(&notifyForge, &frame);
-	}
-
 	scheduleNotifyWaveformToGui = false;
 	lastWaveformCounter = end;
 }
 
 void BJumblr::notifySchedulePageToGui ()
 {
+	if (!notifySpace (notifyObjectSize (1))) return;
+
 	LV2_Atom_Forge_Frame frame;
 	lv2_atom_forge_frame_time(&notifyForge, 0);
 	lv2_atom_forge_object(&notifyForge, &frame, 0, uris.notify_statusEvent);
@@ -1471,6 +2358,8 @@ void BJumblr::notifySchedulePageToGui ()
 
 void BJumblr::notifyPlaybackPageToGui ()
 {
+	if (!notifySpace (notifyObjectSize (1))) return;
+
 	LV2_Atom_Forge_Frame frame;
 	lv2_atom_forge_frame_time(&notifyForge, 0);
 	lv2_atom_forge_object(&notifyForge, &frame, 0, uris.notify_statusEvent);
@@ -1483,6 +2372,8 @@ void BJumblr::notifyPlaybackPageToGui ()
 
 void BJumblr::notifyMidiLearnedToGui ()
 {
+	if (!notifySpace (notifyObjectSize (1))) return;
+
 	uint32_t ml = midiLearned[0] * 0x1000000 + midiLearned[1] * 0x10000 + midiLearned[2] * 0x100 + midiLearned[3];
 	LV2_Atom_Forge_Frame frame;
 	lv2_atom_forge_frame_time(&notifyForge, 0);
@@ -1496,6 +2387,8 @@ void BJumblr::notifyMidiLearnedToGui ()
 
 void BJumblr::notifyMessageToGui()
 {
+	if (!notifySpace (notifyObjectSize (1))) return;
+
 	uint32_t messageNr = message.loadMessage ();
 
 	// Send notifications
@@ -1511,6 +2404,8 @@ void BJumblr::notifySamplePathToGui ()
 {
 	if (sample && sample->path)
 	{
+		if (!notifySpace (notifyObjectSize (4, strlen (sample->path) + 2))) return;
+
 		LV2_Atom_Forge_Frame frame;
 		lv2_atom_forge_frame_time(&notifyForge, 0);
 
@@ -1532,6 +2427,8 @@ void BJumblr::notifySamplePathToGui ()
 
 void BJumblr::notifyStateChanged()
 {
+	if (!notifySpace (notifyObjectSize (0))) return;
+
 	LV2_Atom_Forge_Frame frame;
 	lv2_atom_forge_frame_time(&notifyForge, 0);
 	lv2_atom_forge_object(&notifyForge, &frame, 0, uris.state_StateChanged);
@@ -1550,7 +2447,7 @@ static LV2_Handle instantiate (const LV2_Descriptor* descriptor, double samplera
 {
 	// New instance
 	BJumblr* instance;
-	try {instance = new BJumblr(samplerate, features);}
+	try {instance = new BJumblr(samplerate, getChannelsFromUri (descriptor->URI), features);}
 	catch (std::exception& exc)
 	{
 		fprintf (stderr, "BJumblr.lv2: Plugin instantiation failed. %s\n", exc.what ());
@@ -1648,12 +2545,51 @@ static const LV2_Descriptor descriptor =
 		extension_data
 };
 
+static const LV2_Descriptor monoDescriptor =
+{
+		BJUMBLR_MONO_URI,
+		instantiate,
+		connect_port,
+		activate,
+		run,
+		deactivate,
+		cleanup,
+		extension_data
+};
+
+static const LV2_Descriptor quadDescriptor =
+{
+		BJUMBLR_QUAD_URI,
+		instantiate,
+		connect_port,
+		activate,
+		run,
+		deactivate,
+		cleanup,
+		extension_data
+};
+
+static const LV2_Descriptor surroundDescriptor =
+{
+		BJUMBLR_51_URI,
+		instantiate,
+		connect_port,
+		activate,
+		run,
+		deactivate,
+		cleanup,
+		extension_data
+};
+
 // LV2 Symbol Export
 LV2_SYMBOL_EXPORT const LV2_Descriptor* lv2_descriptor (uint32_t index)
 {
 	switch (index)
 	{
 	case 0: return &descriptor;
+	case 1: return &monoDescriptor;
+	case 2: return &quadDescriptor;
+	case 3: return &surroundDescriptor;
 	default: return NULL;
 	}
 }
@@ -22,6 +22,11 @@
 #define BJUMBLR_HPP_
 
 #define FADETIME 0.01
+#define DEFAULT_BLOCKLENGTH 4096
+#define OBJECTHANDLERSLOTS 16
+#define GUI_UPDATE_RATE 30.0	// Max. rate of cursor, status and waveform notifications in Hz
+#define HISTORY_SHRINK_TIME 10.0	// Time in s a history four times larger than required is kept
+#define HISTORY_RETRY_TIME 5.0	// Time in s until a failed history allocation is retried
 #define CONTROLLER_CHANGED(con) ((new_controllers[con]) ? (controllers[con] != *(new_controllers[con])) : false)
 
 #include <cmath>
@@ -30,6 +35,10 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <mutex>
+#include <climits>
+#include <algorithm>
 #include <stdexcept>
 #include <lv2/lv2plug.in/ns/lv2core/lv2.h>
 #include <lv2/lv2plug.in/ns/ext/atom/atom.h>
@@ -40,11 +49,26 @@
 #include <lv2/lv2plug.in/ns/ext/midi/midi.h>
 #include <lv2/lv2plug.in/ns/ext/state/state.h>
 #include "lv2/lv2plug.in/ns/ext/worker/worker.h"
+#include <lv2/lv2plug.in/ns/ext/options/options.h>
 #include "definitions.h"
 #include "Ports.hpp"
 #include "Urids.hpp"
 #include "Pad.hpp"
 #include "PadMessage.hpp"
+#include "PadNotifyQueue.hpp"
+#include "PadSchedule.hpp"
+#include "PatternSet.hpp"
+#include "PatternChunk.hpp"
+#include "PatternText.hpp"
+#include "SeqLock.hpp"
+#include "MixKernels.hpp"
+#include "MidiPageTable.hpp"
+#include "PerformanceMeter.hpp"
+#include "TraceRing.hpp"
+#include "LogRing.hpp"
+#include "Telemetry.hpp"
+#include "WaveformEnvelope.hpp"
+#include "FrameRing.hpp"
 #include "Message.hpp"
 #include "sndfile.h"
 
@@ -57,10 +81,16 @@ struct Limit
 	float step;
 };
 
+struct PadTap
+{
+	float level;
+	size_t offset;
+};
+
 class BJumblr
 {
 public:
-	BJumblr (double samplerate, const LV2_Feature* const* features);
+	BJumblr (double samplerate, const int channels, const LV2_Feature* const* features);
 	~BJumblr();
 	void connect_port(uint32_t port, void *data);
 	void run(uint32_t n_samples);
@@ -73,15 +103,55 @@ public:
 
 private:
 
+	double getPosition (const int64_t frame) const;
+	void updatePositionIncrement (const int64_t frame);
 	double getPositionFromBeats (const double beats) const;
-	double getPositionFromFrames (const uint64_t frames) const;
+	double getPositionFromFrames (const int64_t frames) const;
+	template <int base> double getPositionFromFrames (const int64_t frames) const;
 	double getPositionFromSeconds (const double seconds) const;
 	uint64_t getFramesFromValue (const double value) const;
+	double getFramesPerValue () const;
+	template <int base> double getFramesPerValue () const;
+	double getStepDuration () const;
+	template <int base> double getStepDuration () const;
 	void runSequencer (const int start, const int end);
+	template <int channels, int source, int play, int mode, int base, bool monitor> void runSequencer (const int start, const int end);
+	template <int channels, int source, int base> void storeInput (const int start, const int nr, const double pos, const double posInc);
+	template <int channels, int mode> void playPads (const int start, const int nr, const int iStep, const double fade, const double fadeInc);
+	template <int channels> void mixTap (const int start, const int nr, const size_t offset, const float gain, const float gainInc);
+	template <int mode> int getPadTaps (const int page, const int iStep, PadTap* taps) const;
+	LV2_Worker_Status scheduleWork (const uint32_t size, const void* data);
+	void requestPadSchedule ();
+	PatternSet* installPatterns (PatternSet* patternSet);
+	void retirePatterns ();
+	bool updateStateSnapshot ();
+	void updateAudioBufferSize ();
+	void requestHistory ();
+	void requestWaveform ();
+	void requestLogDrain ();
+	void logMessage (const LogCode code, const int32_t arg0 = 0, const int32_t arg1 = 0, const int32_t arg2 = 0);
+	void updateWaveform (const int nr, const double pos, const double posInc);
+	void updatePerformancePorts (const uint32_t n_samples, const int64_t runTime);
+	typedef void (BJumblr::*ObjectHandler) (const LV2_Atom_Object* obj, const int64_t frame);
+	struct ObjectDispatch
+	{
+		LV2_URID otype;
+		ObjectHandler handler;
+		bool changesState;	// Handler changes saved state, run within stateLock
+	};
+	void addObjectHandler (const LV2_URID otype, const ObjectHandler handler, const bool changesState = false);
+	const ObjectDispatch* getObjectDispatch (const LV2_URID otype) const;
+	void onUiOn (const LV2_Atom_Object* obj, const int64_t frame);
+	void onUiOff (const LV2_Atom_Object* obj, const int64_t frame);
+	void onPadEvent (const LV2_Atom_Object* obj, const int64_t frame);
+	void onStatusEvent (const LV2_Atom_Object* obj, const int64_t frame);
+	void onPathEvent (const LV2_Atom_Object* obj, const int64_t frame);
+	void onTraceEvent (const LV2_Atom_Object* obj, const int64_t frame);
+	void onTimePosition (const LV2_Atom_Object* obj, const int64_t frame);
 	float validateValue (float value, const Limit limit);
 	Pad validatePad (Pad pad);
-	bool padMessageBufferAppendPad (int page, int row, int step, Pad pad);
 	LV2_Atom_Forge_Ref forgeSamplePath (LV2_Atom_Forge* forge, LV2_Atom_Forge_Frame* frame, const char* path, const int64_t start, const int64_t end, const float amp, const int32_t loop);
+	bool notifySpace (const uint32_t size) const;
 	void notifyPadsToGui ();
 	void notifyStatusToGui ();
 	void notifyWaveformToGui (const int start, const int end);
@@ -102,23 +172,28 @@ private:
 	// DSP <-> GUI communication
 	const LV2_Atom_Sequence* controlPort;
 	LV2_Atom_Sequence* notifyPort;
-	float* audioInput1;
-	float* audioInput2;
-	float* audioOutput1;
-	float* audioOutput2;
+	float* audioInputs[MAXCHANNELS];
+	float* audioOutputs[MAXCHANNELS];
+	float* freewheelPort;
+	float* performancePorts[NR_PERFORMANCE_PORTS];
 
 	LV2_Atom_Forge notifyForge;
 	LV2_Atom_Forge_Frame notifyFrame;
 
-	std::array<std::array <PadMessage, MAXSTEPS * MAXSTEPS>, MAXPAGES> padMessageBuffer;
+	PadNotifyQueue padNotifications;
 
-	float waveform[WAVEFORMSIZE];
+	EnvelopeSlot waveform[WAVEFORMSIZE];
 	int waveformCounter;
 	int lastWaveformCounter;
+	EnvelopeSlot waveformBuffer[WAVEFORMSIZE];	// Written by the worker
+	uint8_t waveformTransport[sizeof (WaveformEnvelopeHeader) + WAVEFORMSIZE * 2 * sizeof (int16_t)];
+	bool waveformOutdated;
+	bool waveformRequested;
 
 	// Controllers
 	float* new_controllers [MAXCONTROLLERS];
 	float controllers [MAXCONTROLLERS];
+	float rawControllers [MAXCONTROLLERS];	// Last validated port values
 	Limit controllerLimits [MAXCONTROLLERS] =
 	{
 		{0, 1, 1},		// SOURCE
@@ -204,12 +279,51 @@ private:
 	int schedulePage;
 	int playPage;
 	int lastPage;
-	Pad pads [MAXPAGES] [MAXSTEPS] [MAXSTEPS];
+	PatternSet* patterns;
+	Pad (*pads) [MAXSTEPS] [MAXSTEPS];	// patterns->pads
+	std::atomic<PatternSet*> restoredPatterns;	// Published by state_restore ()
+	PatternSet* retiredPatterns;	// To be freed by the worker
 	bool patternFlipped;
+	uint32_t padsVersion;
+
+	// Compiled pads, (re)built by the worker
+	PadSchedule padSchedules [2];
+	PadSchedule* padSchedule;
+	bool padScheduleRequested;
+	size_t tapOffsets [MAXSTEPS];
+	int tapShift;
+	MixKernels mixKernels;
+	MidiPageTable midiPageTable;
+	PerformanceMeter performanceMeter;
+	TraceRing trace;
+	LogRing rtLog;
+	bool logDrainRequested;
+	int64_t logMessageTimeout;	// Frames until the GUI log message is removed
+	int activePads;
+
+	ObjectDispatch objectHandlers[OBJECTHANDLERSLOTS];	// Open addressing by otype
 
 	Sample* sample;
 	float sampleAmp;
 
+	// Consistent copy of the data stored by state_save ()
+	struct StateSnapshot
+	{
+		PatternSet patterns;
+		char samplePath[PATH_MAX];	// Empty if no sample is saved
+		int64_t sampleStart;
+		int64_t sampleEnd;
+		float sampleAmp;
+		bool sampleLoop;
+		std::vector<uint8_t> padData;	// patterns.pads encoded as pattern chunk
+		uint32_t sequence;
+		bool valid;
+	};
+
+	SeqLock stateLock;		// Written by the audio thread around state changes
+	StateSnapshot* stateSnapshot;	// Allocated and used by state_save () only
+	std::mutex freeMutex;		// Defers freeing of samples and patterns while saving
+
 	struct WorkerMessage
 	{
 		LV2_Atom atom;
@@ -220,8 +334,43 @@ private:
 		int32_t loop;
 	};
 
+	struct ScheduleMessage
+	{
+		LV2_Atom atom;
+		PadSchedule* schedule;
+		const PatternSet* patterns;
+		uint32_t version;
+		int32_t nrOfSteps;
+	};
+
+	struct WaveformMessage
+	{
+		LV2_Atom atom;
+		const FrameRing* history;
+		size_t counter;
+		size_t size;
+		double position;
+	};
+
+	struct PatternMessage
+	{
+		LV2_Atom atom;
+		PatternSet* patterns;
+	};
+
+	struct HistoryMessage
+	{
+		LV2_Atom atom;
+		FrameRing* history;
+		size_t counter;
+		size_t size;
+	};
+
 	// Host communicated data
 	double rate;
+	int nrChannels;
+	int maxBlockLength;
+	int nominalBlockLength;
 	float bpm;
 	float beatsPerBar;
 	int beatUnit;
@@ -232,23 +381,27 @@ private:
 
 	// Position data
 	double position;
+	double positionInc;
 	float cursor;
 	double offset;
-	uint64_t refFrame;
+	int64_t refFrame;
 	float progressionDelay;
 	float progressionDelayFrac;
 
 	size_t maxBufferSize;
-	std::vector<float> audioBuffer1;
-	std::vector<float> audioBuffer2;
+	FrameRing* history;
+	bool historyRequested;
+	int64_t historyShrinkTimeout;	// Frames until an oversized history is shrunk
+	int64_t historyRetryTimeout;	// Frames until a failed history request is retried
+	std::vector<float> mixBuffer;	// Interleaved, channels * maxBlockLength
 	size_t audioBufferCounter;
 	size_t audioBufferSize;
+	size_t requiredBufferSize;
 
 	// Internals
 	bool activated;
+	bool freewheeling;
 	bool ui_on;
-	bool scheduleNotifyPadsToGui;
-	bool scheduleNotifyFullPatternToGui[MAXPAGES];
 	bool scheduleNotifySchedulePageToGui;
 	bool scheduleNotifyPlaybackPageToGui;
 	bool scheduleNotifyStatusToGui;
@@ -257,6 +410,13 @@ private:
 	bool scheduleNotifyMidiLearnedToGui;
 	bool scheduleNotifyStateChanged;
 	Message message;
+	Telemetry telemetry;
+
+	// Status last notified to the GUI
+	bool statusNotified;
+	float notifiedCursor;
+	float notifiedDelay;
+	bool notifiedFlipped;
 };
 
 #endif /* BJUMBLR_HPP_ */
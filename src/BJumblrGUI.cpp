@@ -30,7 +30,7 @@ inline double floormod (const double numer, const double denom) {return numer -
 
 BJumblrGUI::BJumblrGUI (const char *bundle_path, const LV2_Feature *const *features, PuglNativeView parentWindow) :
 	Window (1020, 620, "B.Jumblr", parentWindow, true, PUGL_MODULE, 0),
-	controller (NULL), write_function (NULL),
+	controller (NULL), write_function (NULL), controllersPort (CONTROLLERS),
 	pluginPath (bundle_path ? std::string (bundle_path) : std::string ("")),
 	sz (1.0), bgImageSurface (nullptr),
 	uris (), forge (), editMode (0),
@@ -665,27 +665,16 @@ void BJumblrGUI::port_event(uint32_t port, uint32_t buffer_size,
 			// Monitor notification
 			if (obj->body.otype == uris.notify_waveformEvent)
 			{
-				int start = -1;
+				const LV2_Atom *oEnvelope = NULL;
+				lv2_atom_object_get (obj, uris.notify_waveformEnvelope, &oEnvelope, NULL);
 
-				const LV2_Atom *oStart = NULL, *oData = NULL;
-				lv2_atom_object_get (obj,
-						     uris.notify_waveformStart, &oStart,
-						     uris.notify_waveformData, &oData,
-						     NULL);
-				if (oStart && (oStart->type == uris.atom_Int)) start = ((LV2_Atom_Int*)oStart)->body;
-
-				if (oData && (oData->type == uris.atom_Vector))
+				if (oEnvelope && (oEnvelope->type == uris.atom_Chunk))
 				{
-					const LV2_Atom_Vector* vec = (const LV2_Atom_Vector*) oData;
-					if (vec->body.child_type == uris.atom_Float)
+					int start = 0;
+					int size = 0;
+					if (monitorWidget.addEnvelope ((const uint8_t*) LV2_ATOM_BODY_CONST (oEnvelope), oEnvelope->size, start, size) && (size > 0))
 					{
-						uint32_t size = (uint32_t) ((oData->size - sizeof(LV2_Atom_Vector_Body)) / sizeof (float));
-						float* data = (float*) (&vec->body + 1);
-						if ((start >= 0) && (size > 0))
-						{
-							monitorWidget.addData (start, size, data);
-							monitorWidget.redrawRange (start, size);
-						}
+						monitorWidget.redrawRange (start, size);
 					}
 				}
 			}
@@ -693,10 +682,10 @@ void BJumblrGUI::port_event(uint32_t port, uint32_t buffer_size,
 	}
 
 	// Scan remaining ports
-	else if ((format == 0) && (port >= CONTROLLERS))
+	else if ((format == 0) && (int (port) >= controllersPort) && (int (port) < controllersPort + MAXCONTROLLERS))
 	{
 		float* pval = (float*) buffer;
-		controllerWidgets[port - CONTROLLERS]->setValue (*pval);
+		controllerWidgets[port - controllersPort]->setValue (*pval);
 	}
 
 }
@@ -1387,7 +1376,7 @@ void BJumblrGUI::valueChangedCallback(BEvents::Event* event)
 	if (controllerNr >= 0)
 	{
 		ui->controllers[controllerNr] = value;
-		ui->write_function(ui->controller, CONTROLLERS + controllerNr, sizeof(float), 0, &ui->controllers[controllerNr]);
+		ui->write_function(ui->controller, ui->controllersPort + controllerNr, sizeof(float), 0, &ui->controllers[controllerNr]);
 
 		switch (controllerNr)
 		{
@@ -2395,7 +2384,8 @@ static LV2UI_Handle instantiate (const LV2UI_Descriptor *descriptor,
 	PuglNativeView parentWindow = 0;
 	LV2UI_Resize* resize = NULL;
 
-	if (strcmp(plugin_uri, BJUMBLR_URI) != 0)
+	const int channels = getChannelsFromUri (plugin_uri);
+	if (channels == 0)
 	{
 		std::cerr << "BJumblr.lv2#GUI: GUI does not support plugin with URI " << plugin_uri << std::endl;
 		return NULL;
@@ -2419,6 +2409,7 @@ static LV2UI_Handle instantiate (const LV2UI_Descriptor *descriptor,
 
 	ui->controller = controller;
 	ui->write_function = write_function;
+	ui->controllersPort = getControllersPort (channels);
 
 	// Reduce min GUI size for small displays
 	double sz = 1.0;
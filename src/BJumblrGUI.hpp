@@ -126,6 +126,7 @@ public:
 
 	LV2UI_Controller controller;
 	LV2UI_Write_Function write_function;
+	int controllersPort;	// Depends on the number of audio channels
 
 private:
 	static void valueChangedCallback(BEvents::Event* event);
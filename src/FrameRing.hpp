@@ -0,0 +1,202 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef FRAMERING_HPP_
+#define FRAMERING_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#if defined (__unix__) || defined (__APPLE__)
+#define FRAMERING_MMAP
+#include <sys/mman.h>
+#endif
+
+// FRAMERING_EAGER commits and zero-fills the whole storage on allocation
+// (the behaviour before lazy allocation). Only used to compare both in
+// benchmarks.
+#if defined (FRAMERING_EAGER) && defined (MAP_POPULATE)
+#define FRAMERING_MAP_FLAGS (MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE)
+#else
+#define FRAMERING_MAP_FLAGS (MAP_PRIVATE | MAP_ANONYMOUS)
+#endif
+
+#define FRAMERING_ALIGNMENT 64
+
+/*
+ * Ring buffer of interleaved multi-channel frames. The capacity is rounded
+ * up to a power of two, thus frames are addressed by masking. The storage
+ * is aligned to cache lines.
+ *
+ * The storage is an anonymous memory mapping (calloc on other platforms).
+ * Its pages are zero-filled on demand by the OS, thus allocation is cheap
+ * and resident memory only grows with the frames actually written.
+ */
+class FrameRing
+{
+public:
+	FrameRing (const int channels) : storage (nullptr), storageSize (0), data (nullptr), nrChannels (channels), capacity (0), bitMask (0) {}
+
+	FrameRing (const int channels, const size_t minSize) : FrameRing (channels) {resize (minSize);}
+
+	FrameRing (const FrameRing& that) = delete;
+
+	FrameRing& operator= (const FrameRing& that) = delete;
+
+	~FrameRing () {deallocate ();}
+
+	/*
+	 * (Re)allocates the ring for at least minSize frames. All frames are
+	 * set to zero. Throws std::bad_alloc on failure.
+	 */
+	void resize (const size_t minSize)
+	{
+		size_t n = 1;
+		while (n < minSize) n <<= 1;
+
+		deallocate ();
+		storageSize = nrChannels * n * sizeof (float) + FRAMERING_ALIGNMENT;
+
+#ifdef FRAMERING_MMAP
+		void* p = mmap (nullptr, storageSize, PROT_READ | PROT_WRITE, FRAMERING_MAP_FLAGS, -1, 0);
+		if (p == MAP_FAILED) p = nullptr;
+#else
+		void* p = calloc (storageSize, 1);
+#endif
+		if (!p)
+		{
+			storageSize = 0;
+			throw std::bad_alloc ();
+		}
+
+		storage = p;
+		const uintptr_t addr = reinterpret_cast<uintptr_t> (p);
+		data = reinterpret_cast<float*> ((addr + FRAMERING_ALIGNMENT - 1) & ~uintptr_t (FRAMERING_ALIGNMENT - 1));
+		capacity = n;
+		bitMask = n - 1;
+	}
+
+	int channels () const {return nrChannels;}
+
+	size_t size () const {return capacity;}
+
+	size_t mask () const {return bitMask;}
+
+	/*
+	 * Returns a pointer to the frame (channels () floats) at (frame mod size ()).
+	 * The following frames are contiguous up to the end of the ring (see
+	 * framesToEnd ()).
+	 */
+	float* frame (const size_t frame) {return &data[nrChannels * (frame & bitMask)];}
+
+	const float* frame (const size_t frame) const {return &data[nrChannels * (frame & bitMask)];}
+
+	size_t framesToEnd (const size_t frame) const {return capacity - (frame & bitMask);}
+
+	/*
+	 * Copies nr frames starting at frame number start from that ring to
+	 * the same frame numbers of this ring. Both rings must have the same
+	 * number of channels.
+	 */
+	void copy (const FrameRing& that, const size_t start, const size_t nr)
+	{
+		for (size_t j = 0; j < nr; ++j)
+		{
+			const float* src = that.frame (start + j);
+			float* dst = frame (start + j);
+			for (int c = 0; c < nrChannels; ++c) dst[c] = src[c];
+		}
+	}
+
+	/*
+	 * Sets nr frames starting at frame number start to zero.
+	 */
+	void clear (const size_t start, const size_t nr)
+	{
+		for (size_t j = 0; j < nr; ++j)
+		{
+			float* dst = frame (start + j);
+			for (int c = 0; c < nrChannels; ++c) dst[c] = 0.0f;
+		}
+	}
+
+	/*
+	 * Copies the frames before frame number counter from that ring (the
+	 * history at request time) to this ring, as many as both rings hold.
+	 */
+	void copyHistory (const FrameRing& that, const size_t counter)
+	{
+		const size_t nr = std::min (capacity, that.size ());
+		copy (that, counter - nr, nr);
+	}
+
+	/*
+	 * Completes a history copied by copyHistory (that, requestCounter)
+	 * while that ring was written up to frame number counter: Copies the
+	 * frames written in the meantime (as far as that ring still holds
+	 * them). These frames have overwritten the same number of the oldest
+	 * frames of that ring, possibly while they were copied. Clears them
+	 * instead of keeping a torn copy, as far as this ring holds them.
+	 */
+	void patchHistory (const FrameRing& that, const size_t requestCounter, const size_t counter)
+	{
+		const size_t age = counter - requestCounter;
+		const size_t written = std::min (age, that.size ());
+		copy (that, counter - written, written);
+
+		// Overwritten frames: The age frames before counter - that.size ()
+		if (that.size () < capacity)
+		{
+			const size_t nr = std::min (age, capacity - that.size ());
+			clear (counter - that.size () - nr, nr);
+		}
+	}
+
+private:
+	void deallocate ()
+	{
+		if (storage)
+		{
+#ifdef FRAMERING_MMAP
+			munmap (storage, storageSize);
+#else
+			free (storage);
+#endif
+		}
+
+		storage = nullptr;
+		storageSize = 0;
+		data = nullptr;
+		capacity = 0;
+		bitMask = 0;
+	}
+
+	void* storage;
+	size_t storageSize;
+	float* data;
+	int nrChannels;
+	size_t capacity;
+	size_t bitMask;
+};
+
+#endif /* FRAMERING_HPP_ */
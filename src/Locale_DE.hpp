@@ -3,6 +3,8 @@
 
 #define BJUMBLR_LABEL_JACK_OFF "Msg: Jack-Transport angehalten."
 #define BJUMBLR_LABEL_CANT_OPEN_SAMPLE "Msg: Sample kann nicht geööfnet werden."
+#define BJUMBLR_LABEL_INVALID_DATA "Msg: Ungültige Daten empfangen. Siehe Log."
+#define BJUMBLR_LABEL_OUT_OF_MEMORY "Msg: Nicht genug Speicher für die Musterlänge."
 #define BJUMBLR_LABEL_SELECT_CUT "Markieren & ausschneiden"
 #define BJUMBLR_LABEL_SELECT_COPY "Markieren & kopieren"
 #define BJUMBLR_LABEL_SELECT_XFLIP "Markieren & X spiegeln"
@@ -3,6 +3,8 @@
 
 #define BJUMBLR_LABEL_JACK_OFF "Msg: Jack transport off or halted. Plugin halted."
 #define BJUMBLR_LABEL_CANT_OPEN_SAMPLE "Msg: Can't open sample file."
+#define BJUMBLR_LABEL_INVALID_DATA "Msg: Invalid data received. See log."
+#define BJUMBLR_LABEL_OUT_OF_MEMORY "Msg: Not enough memory for the pattern length."
 #define BJUMBLR_LABEL_SELECT_CUT "Select & cut"
 #define BJUMBLR_LABEL_SELECT_COPY "Select & copy"
 #define BJUMBLR_LABEL_SELECT_XFLIP "Select & X flip"
@@ -3,6 +3,8 @@
 
 #define BJUMBLR_LABEL_JACK_OFF "Msg : Transport JACK arrêté. Greffon arrêté."
 #define BJUMBLR_LABEL_CANT_OPEN_SAMPLE "Msg : Impossible d'ouvrir le fichier d'échantillon"
+#define BJUMBLR_LABEL_INVALID_DATA "Msg : Données invalides reçues. Voir le journal."
+#define BJUMBLR_LABEL_OUT_OF_MEMORY "Msg : Mémoire insuffisante pour la longueur du motif."
 #define BJUMBLR_LABEL_SELECT_CUT "Sélectionner et couper"
 #define BJUMBLR_LABEL_SELECT_COPY "Sélectionner et copier"
 #define BJUMBLR_LABEL_SELECT_XFLIP "Sélectionner et basculer horizontalement"
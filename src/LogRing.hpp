@@ -0,0 +1,165 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef LOGRING_HPP_
+#define LOGRING_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <array>
+#include "PerformanceMeter.hpp"
+
+#define LOGRING_SIZE 256		// Power of two
+#define LOGRING_BURST 8			// Max. messages per code and window
+#define LOGRING_WINDOW 1000000000	// Rate limit window in ns
+
+enum LogCode
+{
+	LOG_VALUE_OUT_OF_RANGE		= 0,
+	LOG_PAD_OUT_OF_RANGE		= 1,
+	LOG_CORRUPT_PATTERN_SIZE	= 2,
+	NR_LOG_CODES			= 3
+};
+
+/*
+ * Log channel for real-time code. The audio thread (single producer)
+ * pushes message codes and their integer arguments into a preallocated
+ * lock-free ring, a single consumer (the worker) formats and prints them.
+ * Each code is limited to LOGRING_BURST messages per LOGRING_WINDOW.
+ * Messages suppressed by the rate limit or lost due to a full ring are
+ * counted and reported by the consumer.
+ */
+class LogRing
+{
+public:
+	LogRing () :
+		records (), head (0), tail (0), suppressed (), lost (0),
+		windowStart {0}, windowCount {0} {}
+
+	LogRing (const LogRing& that) = delete;
+
+	LogRing& operator= (const LogRing& that) = delete;
+
+	/*
+	 * Queues a message. Producer only.
+	 * @param code		LogCode
+	 * @param arg0..arg2	Integer arguments of the message format
+	 * @return		True if queued, false if suppressed or lost
+	 */
+	bool push (const LogCode code, const int32_t arg0 = 0, const int32_t arg1 = 0, const int32_t arg2 = 0)
+	{
+		const int64_t t = PerformanceMeter::now ();
+		if (t - windowStart[code] >= LOGRING_WINDOW)
+		{
+			windowStart[code] = t;
+			windowCount[code] = 0;
+		}
+
+		if (windowCount[code] >= LOGRING_BURST)
+		{
+			suppressed[code].fetch_add (1, std::memory_order_relaxed);
+			return false;
+		}
+		++windowCount[code];
+
+		const uint32_t h = head.load (std::memory_order_relaxed);
+		if (h - tail.load (std::memory_order_acquire) >= LOGRING_SIZE)
+		{
+			lost.fetch_add (1, std::memory_order_relaxed);
+			return false;
+		}
+
+		records[h & (LOGRING_SIZE - 1)] = Record {code, {arg0, arg1, arg2}};
+		head.store (h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Returns true if there are queued messages or suppressed / lost
+	 * messages not reported yet.
+	 */
+	bool pending () const
+	{
+		if (head.load (std::memory_order_acquire) != tail.load (std::memory_order_acquire)) return true;
+		if (lost.load (std::memory_order_relaxed)) return true;
+		for (const std::atomic<uint32_t>& s : suppressed)
+		{
+			if (s.load (std::memory_order_relaxed)) return true;
+		}
+		return false;
+	}
+
+	/*
+	 * Prints all queued messages and the numbers of suppressed and lost
+	 * messages since the last drain. Consumer only.
+	 * @param f		Output stream
+	 * @return		Number of printed messages
+	 */
+	int drain (FILE* f)
+	{
+		static const char* const formats[NR_LOG_CODES] =
+		{
+			"BJumblr.lv2: Value out of range in run (): Controller#%i\n",
+			"BJumblr.lv2: Pad out of range in run (): pads[%i][%i][%i].\n",
+			"BJumblr.lv2: Corrupt pattern size of %i for page %i.\n"
+		};
+
+		const uint32_t h = head.load (std::memory_order_acquire);
+		uint32_t t = tail.load (std::memory_order_relaxed);
+		int nr = 0;
+		for (; t != h; ++t, ++nr)
+		{
+			const Record& r = records[t & (LOGRING_SIZE - 1)];
+			if (r.code < NR_LOG_CODES) fprintf (f, formats[r.code], r.args[0], r.args[1], r.args[2]);
+		}
+		tail.store (t, std::memory_order_release);
+
+		for (int c = 0; c < NR_LOG_CODES; ++c)
+		{
+			const uint32_t s = suppressed[c].exchange (0, std::memory_order_relaxed);
+			if (s) fprintf (f, "BJumblr.lv2: %u similar messages suppressed.\n", s);
+		}
+
+		const uint32_t l = lost.exchange (0, std::memory_order_relaxed);
+		if (l) fprintf (f, "BJumblr.lv2: %u log messages lost.\n", l);
+
+		return nr;
+	}
+
+private:
+	struct Record
+	{
+		uint32_t code;
+		int32_t args[3];
+	};
+
+	std::array<Record, LOGRING_SIZE> records;
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+	std::array<std::atomic<uint32_t>, NR_LOG_CODES> suppressed;
+	std::atomic<uint32_t> lost;
+
+	// Rate limit state, producer only
+	int64_t windowStart[NR_LOG_CODES];
+	uint32_t windowCount[NR_LOG_CODES];
+};
+
+#endif /* LOGRING_HPP_ */
@@ -29,20 +29,24 @@
 #include "Locale_EN.hpp"
 #endif
 
-#define MAXMESSAGES 3
+#define MAXMESSAGES 5
 
 enum MessageNr
 {
 	NO_MSG			= 0,
 	JACK_STOP_MSG		= 1,
-	CANT_OPEN_SAMPLE	= 2
+	CANT_OPEN_SAMPLE	= 2,
+	INVALID_DATA_MSG	= 3,
+	OUT_OF_MEMORY_MSG	= 4
 };
 
 const std::string messageStrings[MAXMESSAGES] =
 {
 	"",
 	BJUMBLR_LABEL_JACK_OFF,
-	BJUMBLR_LABEL_CANT_OPEN_SAMPLE
+	BJUMBLR_LABEL_CANT_OPEN_SAMPLE,
+	BJUMBLR_LABEL_INVALID_DATA,
+	BJUMBLR_LABEL_OUT_OF_MEMORY
 };
 
 #endif /* MESSAGEDEFINITIONS_HPP_ */
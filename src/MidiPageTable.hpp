@@ -0,0 +1,106 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MIDIPAGETABLE_HPP_
+#define MIDIPAGETABLE_HPP_
+
+#include <cstdint>
+#include "definitions.h"
+#include "Ports.hpp"
+
+/*
+ * Compiled MIDI page triggers. Each entry is a bit mask of the pages (bit
+ * p for page p) matching the respective part of a MIDI message. Thus the
+ * pages triggered by a message are the intersection of three table
+ * entries and the lowest of them wins.
+ */
+struct MidiPageTable
+{
+	uint16_t statusChannel [16] [16];
+	uint16_t note [256];
+	uint16_t value [256];
+
+	MidiPageTable () : statusChannel {{0}}, note {0}, value {0} {}
+
+	/*
+	 * Compiles the page triggers.
+	 * @param midiControllers	STATUS, CHANNEL, NOTE and VALUE
+	 *				controllers of all MAXPAGES pages
+	 */
+	void build (const float* midiControllers)
+	{
+		for (int s = 0; s < 16; ++s)
+		{
+			for (int c = 0; c < 16; ++c) statusChannel[s][c] = 0;
+		}
+
+		for (int i = 0; i < 256; ++i)
+		{
+			note[i] = 0;
+			value[i] = 0;
+		}
+
+		for (int p = 0; p < MAXPAGES; ++p)
+		{
+			const float* ctrl = &midiControllers[p * NR_MIDI_CTRLS];
+			const uint16_t bit = 1 << p;
+
+			for (int s = 1; s < 16; ++s)
+			{
+				if (ctrl[STATUS] != s) continue;
+				for (int c = 0; c < 16; ++c)
+				{
+					if ((ctrl[CHANNEL] == 0) || (ctrl[CHANNEL] - 1 == c)) statusChannel[s][c] |= bit;
+				}
+			}
+
+			for (int i = 0; i < 256; ++i)
+			{
+				if ((ctrl[NOTE] == 128) || (ctrl[NOTE] == i)) note[i] |= bit;
+				if ((ctrl[VALUE] == 128) || (ctrl[VALUE] == i)) value[i] |= bit;
+			}
+		}
+	}
+
+	/*
+	 * Looks up the page triggered by a MIDI message.
+	 * @param status	Status (upper nibble of the status byte)
+	 * @param channel	Channel (0..15)
+	 * @param note		Note (or controller) number
+	 * @param value		Velocity (or controller value)
+	 * @param nrPages	Number of pages in use
+	 * @return		Lowest triggered page or -1 if none
+	 */
+	int getPage (const uint8_t status, const uint8_t channel, const uint8_t note, const uint8_t value, const int nrPages) const
+	{
+		const uint32_t pages = statusChannel[status & 0x0F][channel & 0x0F] & this->note[note] & this->value[value] & ((1u << nrPages) - 1);
+		if (!pages) return -1;
+
+#ifdef __GNUC__
+		return __builtin_ctz (pages);
+#else
+		int p = 0;
+		while (!(pages & (1u << p))) ++p;
+		return p;
+#endif
+	}
+};
+
+#endif /* MIDIPAGETABLE_HPP_ */
@@ -0,0 +1,170 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MIXKERNELS_HPP_
+#define MIXKERNELS_HPP_
+
+#if defined (__x86_64__) && defined (__GNUC__)
+#define MIXKERNELS_X86_64
+#include <immintrin.h>
+#endif
+
+/*
+ * Multiply-accumulate kernels for contiguous segments of interleaved
+ * frames:
+ * mac:		dst[i] += gain * src[i] for n floats (any number of channels)
+ * macRamp:	dst[2i + c] += (gain + i * gainInc) * src[2i + c] for n stereo
+ *		frames (2 * n floats)
+ * macRampFrames<channels> is the generic (compiler vectorized) ramp for
+ * all other numbers of channels.
+ *
+ * All kernels use the same order of operations and the vectorized kernels
+ * don't use FMA. Thus they produce the same results as the scalar reference
+ * kernels (as long as the compiler doesn't contract the scalar code to FMA,
+ * e.g. due to -march=native).
+ */
+
+typedef void (*MacFunction) (float* dst, const float* src, const int n, const float gain);
+typedef void (*MacRampFunction) (float* dst, const float* src, const int n, const float gain, const float gainInc);
+
+struct MixKernels
+{
+	MacFunction mac;
+	MacRampFunction macRamp;
+	const char* name;
+};
+
+inline void macScalar (float* dst, const float* src, const int n, const float gain)
+{
+	for (int i = 0; i < n; ++i) dst[i] += gain * src[i];
+}
+
+inline void macRampScalar (float* dst, const float* src, const int n, const float gain, const float gainInc)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		const float g = gain + float (i) * gainInc;
+		dst[2 * i] += g * src[2 * i];
+		dst[2 * i + 1] += g * src[2 * i + 1];
+	}
+}
+
+template <int channels>
+inline void macRampFrames (float* dst, const float* src, const int n, const float gain, const float gainInc)
+{
+	for (int i = 0; i < n; ++i)
+	{
+		const float g = gain + float (i) * gainInc;
+		for (int c = 0; c < channels; ++c) dst[channels * i + c] += g * src[channels * i + c];
+	}
+}
+
+#ifdef MIXKERNELS_X86_64
+
+__attribute__ ((target ("sse2"))) inline void macSse2 (float* dst, const float* src, const int n, const float gain)
+{
+	const __m128 g = _mm_set1_ps (gain);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) _mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (dst + i), _mm_mul_ps (g, _mm_loadu_ps (src + i))));
+	for (; i < n; ++i) dst[i] += gain * src[i];
+}
+
+__attribute__ ((target ("sse2"))) inline void macRampSse2 (float* dst, const float* src, const int n, const float gain, const float gainInc)
+{
+	const __m128 g = _mm_set1_ps (gain);
+	const __m128 gi = _mm_set1_ps (gainInc);
+	const __m128 lanes = _mm_setr_ps (0.0f, 0.0f, 1.0f, 1.0f);
+	int i = 0;
+	for (; i + 4 <= 2 * n; i += 4)
+	{
+		const __m128 gv = _mm_add_ps (g, _mm_mul_ps (_mm_add_ps (_mm_set1_ps (float (i / 2)), lanes), gi));
+		_mm_storeu_ps (dst + i, _mm_add_ps (_mm_loadu_ps (dst + i), _mm_mul_ps (gv, _mm_loadu_ps (src + i))));
+	}
+	for (; i < 2 * n; ++i) dst[i] += (gain + float (i / 2) * gainInc) * src[i];
+}
+
+__attribute__ ((target ("avx2"))) inline void macAvx2 (float* dst, const float* src, const int n, const float gain)
+{
+	const __m256 g = _mm256_set1_ps (gain);
+	int i = 0;
+	for (; i + 8 <= n; i += 8) _mm256_storeu_ps (dst + i, _mm256_add_ps (_mm256_loadu_ps (dst + i), _mm256_mul_ps (g, _mm256_loadu_ps (src + i))));
+	for (; i < n; ++i) dst[i] += gain * src[i];
+}
+
+__attribute__ ((target ("avx2"))) inline void macRampAvx2 (float* dst, const float* src, const int n, const float gain, const float gainInc)
+{
+	const __m256 g = _mm256_set1_ps (gain);
+	const __m256 gi = _mm256_set1_ps (gainInc);
+	const __m256 lanes = _mm256_setr_ps (0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f);
+	int i = 0;
+	for (; i + 8 <= 2 * n; i += 8)
+	{
+		const __m256 gv = _mm256_add_ps (g, _mm256_mul_ps (_mm256_add_ps (_mm256_set1_ps (float (i / 2)), lanes), gi));
+		_mm256_storeu_ps (dst + i, _mm256_add_ps (_mm256_loadu_ps (dst + i), _mm256_mul_ps (gv, _mm256_loadu_ps (src + i))));
+	}
+	for (; i < 2 * n; ++i) dst[i] += (gain + float (i / 2) * gainInc) * src[i];
+}
+
+// Masked arithmetic intrinsics prevent the compiler from contracting to FMA
+__attribute__ ((target ("avx512f"))) inline void macAvx512 (float* dst, const float* src, const int n, const float gain)
+{
+	const __m512 g = _mm512_set1_ps (gain);
+	for (int i = 0; i < n; i += 16)
+	{
+		const __mmask16 m = (n - i >= 16 ? 0xFFFF : (1 << (n - i)) - 1);
+		const __m512 d = _mm512_maskz_loadu_ps (m, dst + i);
+		const __m512 s = _mm512_maskz_loadu_ps (m, src + i);
+		_mm512_mask_storeu_ps (dst + i, m, _mm512_maskz_add_ps (m, d, _mm512_maskz_mul_ps (m, g, s)));
+	}
+}
+
+__attribute__ ((target ("avx512f"))) inline void macRampAvx512 (float* dst, const float* src, const int n, const float gain, const float gainInc)
+{
+	const __m512 g = _mm512_set1_ps (gain);
+	const __m512 gi = _mm512_set1_ps (gainInc);
+	const __m512 lanes = _mm512_setr_ps (0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f, 4.0f, 4.0f, 5.0f, 5.0f, 6.0f, 6.0f, 7.0f, 7.0f);
+	for (int i = 0; i < 2 * n; i += 16)
+	{
+		const __mmask16 m = (2 * n - i >= 16 ? 0xFFFF : (1 << (2 * n - i)) - 1);
+		const __m512 gv = _mm512_maskz_add_ps (m, g, _mm512_maskz_mul_ps (m, _mm512_maskz_add_ps (m, _mm512_set1_ps (float (i / 2)), lanes), gi));
+		const __m512 d = _mm512_maskz_loadu_ps (m, dst + i);
+		const __m512 s = _mm512_maskz_loadu_ps (m, src + i);
+		_mm512_mask_storeu_ps (dst + i, m, _mm512_maskz_add_ps (m, d, _mm512_maskz_mul_ps (m, gv, s)));
+	}
+}
+
+#endif /* MIXKERNELS_X86_64 */
+
+/*
+ * Returns the fastest set of kernels supported by the CPU.
+ */
+inline MixKernels getMixKernels ()
+{
+#ifdef MIXKERNELS_X86_64
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx512f")) return MixKernels {macAvx512, macRampAvx512, "AVX-512"};
+	if (__builtin_cpu_supports ("avx2")) return MixKernels {macAvx2, macRampAvx2, "AVX2"};
+	return MixKernels {macSse2, macRampSse2, "SSE2"};
+#else
+	return MixKernels {macScalar, macRampScalar, "scalar"};
+#endif
+}
+
+#endif /* MIXKERNELS_HPP_ */
@@ -23,6 +23,7 @@
 
 #include "BWidgets/Widget.hpp"
 #include "definitions.h"
+#include "WaveformEnvelope.hpp"
 #include <cmath>
 
 class MonitorWidget : public BWidgets::Widget
@@ -40,11 +41,19 @@ public:
                 setFocusable (false);
         }
 
-        void clear () {data.fill (0.0f);}
-
-        void addData (const unsigned int pos, const unsigned int size, const float* data)
+        void clear () {data.fill (EnvelopeSlot {0.0f, 0.0f});}
+
+        /*
+         * Decodes a waveform transport chunk into the min/max envelope.
+         * @param chunk		Chunk data
+         * @param chunkSize	Chunk size in bytes
+         * @param start		Output, first changed slot
+         * @param size		Output, number of changed slots
+         * @return		False if the chunk is invalid
+         */
+        bool addEnvelope (const uint8_t* chunk, const uint32_t chunkSize, int& start, int& size)
         {
-                for (unsigned int i = 0; i < size; ++i) this->data[(i + pos) % WAVEFORMSIZE] = data[i];
+                return decodeWaveformEnvelope (chunk, chunkSize, data.data (), start, size);
         }
 
         void setZoom (const double factor)
@@ -133,27 +142,35 @@ protected:
         		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
         		cairo_paint (cr);
 
+                        // Envelope: along max values forward, along min values back
                         cairo_set_line_width (cr, 1);
-                        if (!flipped) cairo_move_to (cr, getWidth() * double (start) / (WAVEFORMSIZE - 1), getHeight() * (0.5  - (0.48 * data[start] / zoom)));
-                        else cairo_move_to (cr, getWidth() * (0.5  - (0.48 * data[start] / zoom)), getHeight() * double (start) / (WAVEFORMSIZE - 1));
-                        for (int i = start + 1; i <= int (end); ++i)
-                        {
-                                if (!flipped) cairo_line_to (cr, getWidth() * double (i) / (WAVEFORMSIZE - 1), getHeight() * (0.5  - (0.48 * data[i] / zoom)));
-                                else cairo_line_to (cr, getWidth() * (0.5  - (0.48 * data[i] / zoom)), getHeight() * double (i) / (WAVEFORMSIZE - 1));
-                        }
+                        for (int i = start; i <= int (end); ++i) lineTo (cr, i, data[i].max, i == int (start));
+                        for (int i = int (end); i >= int (start); --i) lineTo (cr, i, data[i].min, false);
+                        cairo_close_path (cr);
                         cairo_set_source_rgba (cr, CAIRO_RGBA (col));
+                        cairo_fill_preserve (cr);
                         cairo_stroke (cr);
 
                         cairo_destroy (cr);
                 }
         }
 
+        void lineTo (cairo_t* cr, const int i, const float value, const bool move) const
+        {
+                const double pos = double (i) / (WAVEFORMSIZE - 1);
+                const double level = 0.5  - (0.48 * value / zoom);
+                const double x = (flipped ? getWidth() * level : getWidth() * pos);
+                const double y = (flipped ? getHeight() * pos : getHeight() * level);
+                if (move) cairo_move_to (cr, x, y);
+                else cairo_line_to (cr, x, y);
+        }
+
         virtual void draw (const BUtilities::RectArea& area) override
         {
                 drawData (0, WAVEFORMSIZE - 1);
         }
 
-        std::array<float, WAVEFORMSIZE> data;
+        std::array<EnvelopeSlot, WAVEFORMSIZE> data;
         BColors::ColorSet fgColors;
         double zoom;
         bool flipped;
@@ -0,0 +1,111 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PADNOTIFYQUEUE_HPP_
+#define PADNOTIFYQUEUE_HPP_
+
+#include <cstdint>
+#include "definitions.h"
+#include "Pad.hpp"
+#include "PadMessage.hpp"
+
+static_assert (MAXPAGES <= 32, "PadNotifyQueue page mask is limited to 32 pages");
+
+/*
+ * Pads to be notified to the GUI. Each page has a dirty bitset of its pads
+ * and a queue of their messages in order of their first change. Repeated
+ * changes of a pad overwrite its queued message. A page may alternatively
+ * be marked to send its full pattern. All operations but clear () are O(1),
+ * clear () is O(queued messages of the page).
+ */
+class PadNotifyQueue
+{
+public:
+	PadNotifyQueue () :
+		dirty {{0}}, slots {{0}}, messages (), sizes {0},
+		fullPatternPages (0), dirtyPages (0) {}
+
+	/*
+	 * Queues a pad or updates its queued message.
+	 */
+	void push (const int page, const int row, const int step, const Pad pad)
+	{
+		const int id = step * MAXSTEPS + row;
+		const uint64_t bit = uint64_t (1) << (id & 63);
+		if (dirty[page][id >> 6] & bit) messages[page][slots[page][id]] = PadMessage (step, row, pad);
+		else
+		{
+			dirty[page][id >> 6] |= bit;
+			slots[page][id] = sizes[page];
+			messages[page][sizes[page]] = PadMessage (step, row, pad);
+			++sizes[page];
+		}
+		dirtyPages |= (1u << page);
+	}
+
+	/*
+	 * Marks a page to send its full pattern instead of single pads.
+	 */
+	void markFullPattern (const int page)
+	{
+		fullPatternPages |= (1u << page);
+		dirtyPages |= (1u << page);
+	}
+
+	/*
+	 * @param nrPages	Number of pages to check
+	 * @return		Bit mask of the pages with pending notifications
+	 */
+	uint32_t pendingPages (const int nrPages) const
+	{
+		return (nrPages >= 32 ? dirtyPages : dirtyPages & ((1u << nrPages) - 1));
+	}
+
+	bool isFullPattern (const int page) const {return (fullPatternPages & (1u << page));}
+
+	const PadMessage* data (const int page) const {return messages[page];}
+
+	int size (const int page) const {return sizes[page];}
+
+	/*
+	 * Removes all pending notifications of a page.
+	 */
+	void clear (const int page)
+	{
+		for (int i = 0; i < sizes[page]; ++i)
+		{
+			const int id = int (messages[page][i].step) * MAXSTEPS + int (messages[page][i].row);
+			dirty[page][id >> 6] &= ~(uint64_t (1) << (id & 63));
+		}
+		sizes[page] = 0;
+		fullPatternPages &= ~(1u << page);
+		dirtyPages &= ~(1u << page);
+	}
+
+private:
+	uint64_t dirty [MAXPAGES] [MAXSTEPS * MAXSTEPS / 64];
+	uint16_t slots [MAXPAGES] [MAXSTEPS * MAXSTEPS];
+	PadMessage messages [MAXPAGES] [MAXSTEPS * MAXSTEPS];
+	int sizes [MAXPAGES];
+	uint32_t fullPatternPages;
+	uint32_t dirtyPages;
+};
+
+#endif /* PADNOTIFYQUEUE_HPP_ */
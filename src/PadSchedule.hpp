@@ -0,0 +1,78 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PADSCHEDULE_HPP_
+#define PADSCHEDULE_HPP_
+
+#include <cstdint>
+#include "definitions.h"
+#include "Pad.hpp"
+
+struct PadScheduleEntry
+{
+	float level;
+	int16_t row;
+	int16_t stepDiff;	// (step - row) mod nrOfSteps
+};
+
+/*
+ * Compiled pattern: Dense lists of the active pads (in row order) for each
+ * page and step.
+ */
+struct PadSchedule
+{
+	uint32_t version;
+	int nrOfSteps;
+	uint8_t size [MAXPAGES] [MAXSTEPS];
+	PadScheduleEntry entries [MAXPAGES] [MAXSTEPS] [MAXSTEPS];
+
+	PadSchedule () : version (0), nrOfSteps (0), size {{0}}, entries {} {}
+
+	void build (const Pad (&pads) [MAXPAGES] [MAXSTEPS] [MAXSTEPS], const int nrOfSteps, const uint32_t version)
+	{
+		for (int p = 0; p < MAXPAGES; ++p)
+		{
+			for (int s = 0; s < MAXSTEPS; ++s)
+			{
+				int n = 0;
+				if (s < nrOfSteps)
+				{
+					for (int r = 0; r < nrOfSteps; ++r)
+					{
+						const float level = pads[p][r][s].level;
+						if (level != 0.0f)
+						{
+							entries[p][s][n].level = level;
+							entries[p][s][n].row = r;
+							entries[p][s][n].stepDiff = (s - r + nrOfSteps) % nrOfSteps;
+							++n;
+						}
+					}
+				}
+				size[p][s] = n;
+			}
+		}
+
+		this->nrOfSteps = nrOfSteps;
+		this->version = version;
+	}
+};
+
+#endif /* PADSCHEDULE_HPP_ */
@@ -0,0 +1,161 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PATTERNCHUNK_HPP_
+#define PATTERNCHUNK_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include "definitions.h"
+#include "Pad.hpp"
+
+#define PATTERNCHUNK_VERSION 1
+#define PATTERNCHUNK_HEADER_SIZE 8
+#define PATTERNCHUNK_BITMAP_SIZE (MAXSTEPS * MAXSTEPS / 8)
+
+/*
+ * Binary pattern state (stored as atom:Chunk). All values little endian.
+ *
+ * Header:	"BJP", version (uint8), nrPages (uint8), MAXSTEPS (uint8),
+ *		2 reserved bytes
+ * Each page:	encoding (uint8), followed by (unless PAGE_EMPTY) a bitmap
+ *		of the non-zero pads (bit id = step * MAXSTEPS + row, LSB
+ *		first) and the levels of the non-zero pads in id order
+ *
+ * Pages with levels which are all multiples of 0.01 (as set by the GUI
+ * dial) are stored with one byte per pad, all other pages with the raw
+ * float.
+ */
+enum PatternChunkEncoding
+{
+	PAGE_EMPTY	= 0,
+	PAGE_PERCENT	= 1,
+	PAGE_FLOAT	= 2
+};
+
+/*
+ * Encodes a pattern.
+ * @param pads		Pad matrices of the pages
+ * @param nrPages	Number of pages to be encoded
+ * @param chunk		Output, replaced
+ */
+inline void encodePatternChunk (const Pad (*pads) [MAXSTEPS] [MAXSTEPS], const int nrPages, std::vector<uint8_t>& chunk)
+{
+	const uint8_t header[PATTERNCHUNK_HEADER_SIZE] = {'B', 'J', 'P', PATTERNCHUNK_VERSION, uint8_t (nrPages), MAXSTEPS, 0, 0};
+	chunk.assign (header, header + PATTERNCHUNK_HEADER_SIZE);
+
+	for (int page = 0; page < nrPages; ++page)
+	{
+		uint8_t bitmap[PATTERNCHUNK_BITMAP_SIZE] = {0};
+		int count = 0;
+		bool percent = true;
+		for (int id = 0; id < MAXSTEPS * MAXSTEPS; ++id)
+		{
+			const float level = pads[page][id % MAXSTEPS][id / MAXSTEPS].level;
+			if (level != 0.0f)
+			{
+				bitmap[id >> 3] |= (1 << (id & 7));
+				++count;
+				const long q = lrintf (level * 100.0f);
+				if ((q < 0) || (q > 255) || (float (double (q) / 100.0) != level)) percent = false;
+			}
+		}
+
+		if (count == 0)
+		{
+			chunk.push_back (PAGE_EMPTY);
+			continue;
+		}
+
+		chunk.push_back (percent ? PAGE_PERCENT : PAGE_FLOAT);
+		chunk.insert (chunk.end (), bitmap, bitmap + PATTERNCHUNK_BITMAP_SIZE);
+		for (int id = 0; id < MAXSTEPS * MAXSTEPS; ++id)
+		{
+			const float level = pads[page][id % MAXSTEPS][id / MAXSTEPS].level;
+			if (level == 0.0f) continue;
+
+			if (percent) chunk.push_back (uint8_t (lrintf (level * 100.0f)));
+			else
+			{
+				uint32_t bits;
+				memcpy (&bits, &level, sizeof (bits));
+				for (int b = 0; b < 4; ++b) chunk.push_back (uint8_t (bits >> (8 * b)));
+			}
+		}
+	}
+}
+
+/*
+ * Decodes a pattern. Pads of pages not contained in the chunk are left
+ * untouched.
+ * @param data		Chunk data
+ * @param size		Chunk size in bytes
+ * @param pads		Output, pad matrices of MAXPAGES pages
+ * @param nrPages	Output, number of pages
+ * @return		False if the chunk is invalid (output may be
+ *			incomplete)
+ */
+inline bool decodePatternChunk (const uint8_t* data, const size_t size, Pad (*pads) [MAXSTEPS] [MAXSTEPS], int& nrPages)
+{
+	if ((size < PATTERNCHUNK_HEADER_SIZE) || (memcmp (data, "BJP", 3) != 0)) return false;
+	if ((data[3] == 0) || (data[3] > PATTERNCHUNK_VERSION)) return false;
+	if ((data[4] < 1) || (data[4] > MAXPAGES) || (data[5] != MAXSTEPS)) return false;
+
+	const int pages = data[4];
+	size_t pos = PATTERNCHUNK_HEADER_SIZE;
+	for (int page = 0; page < pages; ++page)
+	{
+		if (pos >= size) return false;
+		const uint8_t encoding = data[pos++];
+		if (encoding == PAGE_EMPTY) continue;
+		if ((encoding != PAGE_PERCENT) && (encoding != PAGE_FLOAT)) return false;
+		if (size - pos < PATTERNCHUNK_BITMAP_SIZE) return false;
+
+		const uint8_t* bitmap = data + pos;
+		pos += PATTERNCHUNK_BITMAP_SIZE;
+		const size_t levelSize = (encoding == PAGE_PERCENT ? 1 : 4);
+		for (int id = 0; id < MAXSTEPS * MAXSTEPS; ++id)
+		{
+			if (!(bitmap[id >> 3] & (1 << (id & 7)))) continue;
+			if (size - pos < levelSize) return false;
+
+			float level;
+			if (encoding == PAGE_PERCENT) level = float (double (data[pos]) / 100.0);
+			else
+			{
+				uint32_t bits = 0;
+				for (int b = 0; b < 4; ++b) bits |= uint32_t (data[pos + b]) << (8 * b);
+				// Reject NaN and inf by the exponent bits, std::isfinite ()
+				// is optimized away by -ffast-math
+				if ((bits & 0x7f800000) == 0x7f800000) return false;
+				memcpy (&level, &bits, sizeof (level));
+			}
+			pos += levelSize;
+			pads[page][id % MAXSTEPS][id / MAXSTEPS] = Pad (level);
+		}
+	}
+
+	nrPages = pages;
+	return true;
+}
+
+#endif /* PATTERNCHUNK_HPP_ */
@@ -0,0 +1,46 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PATTERNSET_HPP_
+#define PATTERNSET_HPP_
+
+#include "definitions.h"
+#include "Pad.hpp"
+
+/*
+ * Pattern data which is replaced as a whole by state_restore (). A restored
+ * set is built off the audio thread and installed by run (). Optional
+ * values are negative if they weren't restored.
+ */
+struct PatternSet
+{
+	Pad pads [MAXPAGES] [MAXSTEPS] [MAXSTEPS];
+	bool padsRestored;
+	int nrPages;
+	int playPage;
+	int editMode;
+	int patternFlipped;
+
+	PatternSet () :
+		pads {Pad()}, padsRestored (false), nrPages (1),
+		playPage (-1), editMode (-1), patternFlipped (-1) {}
+};
+
+#endif /* PATTERNSET_HPP_ */
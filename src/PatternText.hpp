@@ -0,0 +1,141 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PATTERNTEXT_HPP_
+#define PATTERNTEXT_HPP_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "definitions.h"
+#include "Pad.hpp"
+
+/*
+ * Single pass parser for the legacy text pattern state
+ * ("pg:%d; id:%d; lv:%f;" per pad and line). Reads the keywords in the same
+ * order as the former parser, which searched the rest of the text for
+ * "pg:", then "id:", then "lv:" and ignored everything in between: "pg:" is
+ * optional and defaults to page 0 if no "pg:" follows at all, and a level
+ * is assigned to the preceding ID. Invalid lines are reported and skipped.
+ * @param text		NUL terminated text
+ * @param pads		Output, pad matrices of MAXPAGES pages
+ * @param nrPages	Output, raised to the highest page found + 1
+ * @return		Number of invalid lines
+ */
+inline int parsePatternText (const char* text, Pad (*pads) [MAXSTEPS] [MAXSTEPS], int& nrPages)
+{
+	// Position of the last "pg:"
+	const char* lastPage = nullptr;
+	for (const char* s = strstr (text, "pg:"); s; s = strstr (s + 1, "pg:")) lastPage = s;
+
+	int errors = 0;
+	int line = 1;
+	int page = 0;
+	int id = 0;
+	char expected = 'p';
+	bool skipLine = false;
+	const char* c = text;
+
+	while (*c)
+	{
+		if (*c == '\n')
+		{
+			++line;
+			skipLine = false;
+			++c;
+			continue;
+		}
+
+		// No more "pg:": Following pads are on page 0
+		if ((expected == 'p') && ((!lastPage) || (c > lastPage)))
+		{
+			page = 0;
+			expected = 'i';
+		}
+
+		// Look for the expected keyword
+		const char key =
+		(
+			(skipLine || (c[1] == 0) || (c[2] != ':')) ? 0 :
+			((c[0] == 'p') && (c[1] == 'g')) ? 'p' :
+			((c[0] == 'i') && (c[1] == 'd')) ? 'i' :
+			((c[0] == 'l') && (c[1] == 'v')) ? 'l' : 0
+		);
+		if ((!key) || (key != expected))
+		{
+			++c;
+			continue;
+		}
+
+		c += 3;
+		char* end;
+		const char* error = nullptr;
+
+		if (key == 'l')
+		{
+			const float val = strtof (c, &end);
+			if (end == c) error = "Can't parse level";
+			else
+			{
+				pads[page][id % MAXSTEPS][id / MAXSTEPS].level = val;
+				expected = 'p';
+			}
+		}
+
+		else
+		{
+			// Page and ID were read as float and truncated
+			const float val = strtof (c, &end);
+			if (end == c) error = (key == 'p' ? "Can't parse page" : "Can't parse ID");
+			else if (key == 'p')
+			{
+				if (!((val > -1.0f) && (val < MAXPAGES))) error = "Invalid page";
+				else
+				{
+					page = int (val);
+					if (page >= nrPages) nrPages = page + 1;
+					expected = 'i';
+				}
+			}
+			else
+			{
+				if (!((val > -1.0f) && (val < MAXSTEPS * MAXSTEPS))) error = "Invalid ID";
+				else
+				{
+					id = int (val);
+					expected = 'l';
+				}
+			}
+		}
+
+		if (error)
+		{
+			fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. %s in line %i. Line skipped.\n", error, line);
+			++errors;
+			expected = 'p';
+			skipLine = true;
+		}
+		else c = end;
+	}
+
+	return errors;
+}
+
+#endif /* PATTERNTEXT_HPP_ */
@@ -0,0 +1,93 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef PERFORMANCEMETER_HPP_
+#define PERFORMANCEMETER_HPP_
+
+#include <cstdint>
+#include <ctime>
+
+/*
+ * Accumulates the processing time of blocks over a window of audio time
+ * and provides the average and peak processing time per block and the DSP
+ * load (processing time relative to the audio time of the blocks) of the
+ * last completed window. Real-time safe: no allocation, no locks and the
+ * monotonic clock is read without a system call on Linux (vDSO).
+ */
+class PerformanceMeter
+{
+public:
+	PerformanceMeter () :
+		sum (0), peak (0), audioTime (0), count (0),
+		average (0.0f), peakTime (0.0f), load (0.0f) {}
+
+	/*
+	 * Returns the monotonic clock time in ns.
+	 */
+	static int64_t now ()
+	{
+		timespec ts;
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+		return int64_t (ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+
+	/*
+	 * Adds a processed block and completes the window once its audio time
+	 * is reached.
+	 * @param runTime	Processing time of the block in ns
+	 * @param blockTime	Audio time of the block in ns
+	 * @param window	Audio time of the window in ns
+	 */
+	void add (const int64_t runTime, const int64_t blockTime, const int64_t window)
+	{
+		sum += runTime;
+		if (runTime > peak) peak = runTime;
+		audioTime += blockTime;
+		++count;
+
+		if (audioTime >= window)
+		{
+			average = float (sum) / float (count);
+			peakTime = peak;
+			load = (audioTime > 0 ? float (sum) / float (audioTime) : 0.0f);
+			sum = 0;
+			peak = 0;
+			audioTime = 0;
+			count = 0;
+		}
+	}
+
+	float getAverage () const {return average;}
+
+	float getPeak () const {return peakTime;}
+
+	float getLoad () const {return load;}
+
+private:
+	int64_t sum;
+	int64_t peak;
+	int64_t audioTime;
+	int64_t count;
+	float average;
+	float peakTime;
+	float load;
+};
+
+#endif /* PERFORMANCEMETER_HPP_ */
@@ -21,6 +21,9 @@
 #ifndef PORTS_HPP_
 #define PORTS_HPP_
 
+#include <cstring>
+#include "definitions.h"
+
 enum PortIndex {
 	CONTROL			= 0,
 	NOTIFY			= 1,
@@ -46,9 +49,46 @@ enum PortIndex {
 	NOTE			= 2,
 	VALUE			= 3,
 	NR_MIDI_CTRLS		= 4,
-	MAXCONTROLLERS		= MIDI + 16 * NR_MIDI_CTRLS
+	MAXCONTROLLERS		= MIDI + 16 * NR_MIDI_CTRLS,
+
+	FREEWHEEL		= CONTROLLERS + MAXCONTROLLERS,
+
+	PERFORMANCE		= FREEWHEEL + 1,
+	RUN_TIME_AVG		= 0,
+	RUN_TIME_PEAK		= 1,
+	DSP_LOAD		= 2,
+	ACTIVE_PADS		= 3,
+	HISTORY_FILL		= 4,
+	MEMORY			= 5,
+	GUI_OUT_TRAFFIC		= 6,
+	GUI_IN_TRAFFIC		= 7,
+	NR_PERFORMANCE_PORTS	= 8
 };
 
+/*
+ * The port indexes above refer to the stereo plugin. All plugin variants
+ * share the same port order: CONTROL, NOTIFY, the audio inputs, the audio
+ * outputs, the controllers, FREEWHEEL and the performance counters.
+ */
+inline int getAudioInPort (const int channels, const int channel) {return AUDIO_IN_1 + channel;}
+inline int getAudioOutPort (const int channels, const int channel) {return AUDIO_IN_1 + channels + channel;}
+inline int getControllersPort (const int channels) {return AUDIO_IN_1 + 2 * channels;}
+inline int getFreewheelPort (const int channels) {return getControllersPort (channels) + MAXCONTROLLERS;}
+inline int getPerformancePort (const int channels) {return getFreewheelPort (channels) + 1;}
+
+/*
+ * Returns the number of audio channels of a B.Jumblr plugin variant or 0
+ * if uri isn't a B.Jumblr plugin URI.
+ */
+inline int getChannelsFromUri (const char* uri)
+{
+	if (!strcmp (uri, BJUMBLR_URI)) return 2;
+	if (!strcmp (uri, BJUMBLR_MONO_URI)) return 1;
+	if (!strcmp (uri, BJUMBLR_QUAD_URI)) return 4;
+	if (!strcmp (uri, BJUMBLR_51_URI)) return 6;
+	return 0;
+}
+
 enum BaseIndex
 {
 	SECONDS		= 0,
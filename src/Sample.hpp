@@ -179,7 +179,7 @@ struct Sample
         	// Direct access if same frame rate
         	if (info.samplerate == rate)
         	{
-        		if (frame >= info.frames) return 0.0f;
+        		if ((frame < 0) || (frame >= info.frames)) return 0.0f;
         		else return data[frame * info.channels + channel];
         	}
 
@@ -188,7 +188,7 @@ struct Sample
                 const double frac = fmod (f, 1.0);
         	sf_count_t f1 = f;
 
-        	if (f1 >= info.frames) return 0.0f;
+        	if ((f1 < 0) || (f1 >= info.frames)) return 0.0f;
 
         	if (frac == 0.0) return data[f1 * info.channels + channel];
 
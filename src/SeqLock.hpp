@@ -0,0 +1,91 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef SEQLOCK_HPP_
+#define SEQLOCK_HPP_
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+
+/*
+ * Sequence lock for a single writer (the audio thread) and non-RT readers.
+ * The writer never waits: it makes the sequence odd while it changes the
+ * guarded data and even again when done. Readers copy the data and retry
+ * if the sequence was odd or changed meanwhile. An unchanged (even)
+ * sequence also tells a reader that the data are the same as of its last
+ * successful read.
+ */
+class SeqLock
+{
+public:
+	SeqLock () : sequence (0) {}
+
+	SeqLock (const SeqLock& that) = delete;
+
+	SeqLock& operator= (const SeqLock& that) = delete;
+
+	/*
+	 * Marks the begin of a change of the guarded data. Writer only.
+	 */
+	void beginWrite ()
+	{
+		sequence.store (sequence.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence (std::memory_order_release);
+	}
+
+	/*
+	 * Marks the end of a change of the guarded data. Writer only.
+	 */
+	void endWrite ()
+	{
+		sequence.store (sequence.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/*
+	 * Waits until no change is in progress.
+	 * @return	Sequence to be passed to retry ()
+	 */
+	uint32_t beginRead () const
+	{
+		uint32_t s = sequence.load (std::memory_order_acquire);
+		while (s & 1)
+		{
+			std::this_thread::yield ();
+			s = sequence.load (std::memory_order_acquire);
+		}
+		return s;
+	}
+
+	/*
+	 * @param s	Sequence returned by beginRead ()
+	 * @return	True if the data read since beginRead () may be torn
+	 */
+	bool retry (const uint32_t s) const
+	{
+		std::atomic_thread_fence (std::memory_order_acquire);
+		return (sequence.load (std::memory_order_relaxed) != s);
+	}
+
+private:
+	std::atomic<uint32_t> sequence;
+};
+
+#endif /* SEQLOCK_HPP_ */
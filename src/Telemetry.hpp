@@ -0,0 +1,97 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TELEMETRY_HPP_
+#define TELEMETRY_HPP_
+
+#include <cstdint>
+
+/*
+ * Timing and traffic accounting of the DSP <-> GUI communication. Counted
+ * in frames of the audio stream, thus RT safe. Periodic (rate limited)
+ * notifications are due once per interval. The traffic is counted in bytes
+ * and reported as bytes per second of the last full second.
+ */
+class Telemetry
+{
+public:
+	Telemetry () :
+		interval (0.0), countdown (0.0), window (0.0), windowFrames (0.0),
+		toGuiBytes (0), fromGuiBytes (0), toGuiRate (0.0f), fromGuiRate (0.0f) {}
+
+	/*
+	 * @param sampleRate	Sample rate in Hz
+	 * @param updateRate	Max. rate of periodic notifications in Hz
+	 */
+	void setRate (const double sampleRate, const double updateRate)
+	{
+		interval = sampleRate / updateRate;
+		window = sampleRate;
+		countdown = 0.0;
+	}
+
+	/*
+	 * Advances the time by one block. Call once per run ().
+	 * @param frames	Block length
+	 * @return		True if periodic notifications are due
+	 */
+	bool tick (const uint32_t frames)
+	{
+		windowFrames += frames;
+		if (windowFrames >= window)
+		{
+			toGuiRate = toGuiBytes * window / windowFrames;
+			fromGuiRate = fromGuiBytes * window / windowFrames;
+			toGuiBytes = 0;
+			fromGuiBytes = 0;
+			windowFrames = 0.0;
+		}
+
+		countdown -= frames;
+		if (countdown > 0.0) return false;
+		countdown = (countdown + interval > 0.0 ? countdown + interval : interval);
+		return true;
+	}
+
+	/*
+	 * Makes periodic notifications due on the next tick ().
+	 */
+	void force () {countdown = 0.0;}
+
+	void countToGui (const uint32_t bytes) {toGuiBytes += bytes;}
+
+	void countFromGui (const uint32_t bytes) {fromGuiBytes += bytes;}
+
+	float getToGuiRate () const {return toGuiRate;}
+
+	float getFromGuiRate () const {return fromGuiRate;}
+
+private:
+	double interval;
+	double countdown;
+	double window;
+	double windowFrames;
+	uint64_t toGuiBytes;
+	uint64_t fromGuiBytes;
+	float toGuiRate;
+	float fromGuiRate;
+};
+
+#endif /* TELEMETRY_HPP_ */
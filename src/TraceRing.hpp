@@ -0,0 +1,149 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TRACERING_HPP_
+#define TRACERING_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <array>
+#include "PerformanceMeter.hpp"
+
+#define TRACERING_SIZE 16384	// Power of two
+
+enum TraceEventType
+{
+	TRACE_RUN_BEGIN		= 0,
+	TRACE_RUN_END		= 1,
+	TRACE_STEP		= 2,
+	TRACE_PAGE		= 3,
+	TRACE_MIDI		= 4,
+	TRACE_SCHEDULE_WORK	= 5,
+	TRACE_WORK_RESPONSE	= 6,
+	NR_TRACE_EVENT_TYPES	= 7
+};
+
+/*
+ * Preallocated flight recorder for timestamped events of the audio thread.
+ * A single producer (the audio thread) overwrites the oldest events, a
+ * single consumer (the worker) drains the events written since its last
+ * drain. Each slot is guarded by a sequence number (odd while written),
+ * thus the consumer skips slots which are overwritten while read. push ()
+ * is wait-free and doesn't allocate.
+ */
+class TraceRing
+{
+public:
+	TraceRing () : head (0), tail (0) {}
+
+	TraceRing (const TraceRing& that) = delete;
+
+	TraceRing& operator= (const TraceRing& that) = delete;
+
+	/*
+	 * Records an event. Audio thread only.
+	 * @param type		TraceEventType
+	 * @param value		Event data (step, page, URID, ...)
+	 */
+	void push (const TraceEventType type, const int32_t value)
+	{
+		const uint64_t h = head.load (std::memory_order_relaxed);
+		Slot& s = slots[h & (TRACERING_SIZE - 1)];
+		s.seq.store (2 * h + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence (std::memory_order_release);
+		s.time.store (PerformanceMeter::now (), std::memory_order_relaxed);
+		s.type.store (type, std::memory_order_relaxed);
+		s.value.store (value, std::memory_order_relaxed);
+		s.seq.store (2 * h + 2, std::memory_order_release);
+		head.store (h + 1, std::memory_order_release);
+	}
+
+	/*
+	 * Drains the events recorded since the last drain and writes them in
+	 * the Chrome trace event (JSON) format, which is also read by Perfetto.
+	 * Worker thread only.
+	 * @param path		Path of the trace file
+	 * @return		True on success, otherwise false
+	 */
+	bool writeChromeTrace (const char* path)
+	{
+		static const char* const names[NR_TRACE_EVENT_TYPES] =
+		{
+			"run", "run", "step", "page", "midi", "schedule_work", "work_response"
+		};
+		static const char* const args[NR_TRACE_EVENT_TYPES] =
+		{
+			"", "", "step", "page", "page", "type", "type"
+		};
+
+		FILE* f = fopen (path, "w");
+		if (!f) return false;
+
+		const uint64_t h = head.load (std::memory_order_acquire);
+		const uint64_t start = (h - tail > TRACERING_SIZE ? h - TRACERING_SIZE : tail);
+		uint64_t dropped = start - tail;
+		bool first = true;
+
+		fprintf (f, "{\"traceEvents\":[");
+		for (uint64_t i = start; i < h; ++i)
+		{
+			const Slot& s = slots[i & (TRACERING_SIZE - 1)];
+			const uint64_t seq1 = s.seq.load (std::memory_order_acquire);
+			const int64_t time = s.time.load (std::memory_order_relaxed);
+			const uint32_t type = s.type.load (std::memory_order_relaxed);
+			const int32_t value = s.value.load (std::memory_order_relaxed);
+			std::atomic_thread_fence (std::memory_order_acquire);
+			const uint64_t seq2 = s.seq.load (std::memory_order_relaxed);
+
+			// Overwritten meanwhile
+			if ((seq1 != 2 * i + 2) || (seq2 != seq1) || (type >= NR_TRACE_EVENT_TYPES))
+			{
+				++dropped;
+				continue;
+			}
+
+			fprintf (f, "%s\n{\"name\":\"%s\",\"pid\":1,\"tid\":1,\"ts\":%.3f,", (first ? "" : ","), names[type], double (time) / 1000.0);
+			if (type == TRACE_RUN_BEGIN) fprintf (f, "\"ph\":\"B\"}");
+			else if (type == TRACE_RUN_END) fprintf (f, "\"ph\":\"E\"}");
+			else fprintf (f, "\"ph\":\"i\",\"s\":\"t\",\"args\":{\"%s\":%i}}", args[type], value);
+			first = false;
+		}
+		fprintf (f, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":%llu}}\n", (unsigned long long) dropped);
+
+		tail = h;
+		return (fclose (f) == 0);
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<uint64_t> seq {0};
+		std::atomic<int64_t> time {0};
+		std::atomic<uint32_t> type {0};
+		std::atomic<int32_t> value {0};
+	};
+
+	std::array<Slot, TRACERING_SIZE> slots;
+	std::atomic<uint64_t> head;
+	uint64_t tail;	// Consumer only
+};
+
+#endif /* TRACERING_HPP_ */
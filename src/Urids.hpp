@@ -29,6 +29,7 @@
 #include <lv2/lv2plug.in/ns/ext/time/time.h>
 #include <lv2/lv2plug.in/ns/ext/midi/midi.h>
 #include <lv2/lv2plug.in/ns/ext/state/state.h>
+#include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
 #include "definitions.h"
 
 #ifndef LV2_STATE__StateChanged
@@ -42,6 +43,8 @@ struct BJumblrURIs
 	LV2_URID atom_Double;
 	LV2_URID atom_Bool;
 	LV2_URID atom_Int;
+	LV2_URID bufsz_maxBlockLength;
+	LV2_URID bufsz_nominalBlockLength;
 	LV2_URID atom_Object;
 	LV2_URID atom_Blank;
 	LV2_URID atom_eventTransfer;
@@ -49,6 +52,7 @@ struct BJumblrURIs
 	LV2_URID atom_Long;
 	LV2_URID atom_String;
 	LV2_URID atom_Path;
+	LV2_URID atom_Chunk;
 	LV2_URID time_Position;
 	LV2_URID time_bar;
 	LV2_URID time_barBeat;
@@ -61,6 +65,7 @@ struct BJumblrURIs
 	LV2_URID ui_on;
 	LV2_URID ui_off;
 	LV2_URID state_pad;
+	LV2_URID state_patternChunk;
 	LV2_URID notify_padEvent;
 	LV2_URID notify_padPage;
 	LV2_URID notify_pad;
@@ -69,6 +74,17 @@ struct BJumblrURIs
 	LV2_URID notify_editMode;
 	LV2_URID notify_sampleFreeEvent;
 	LV2_URID notify_installSample;
+	LV2_URID notify_buildSchedule;
+	LV2_URID notify_installSchedule;
+	LV2_URID notify_buildWaveform;
+	LV2_URID notify_installWaveform;
+	LV2_URID notify_resizeHistory;
+	LV2_URID notify_installHistory;
+	LV2_URID notify_historyFreeEvent;
+	LV2_URID notify_patternFreeEvent;
+	LV2_URID notify_drainLog;
+	LV2_URID notify_traceEvent;
+	LV2_URID notify_tracePath;
 	LV2_URID notify_pathEvent;
 	LV2_URID notify_samplePath;
 	LV2_URID notify_sampleStart;
@@ -86,8 +102,7 @@ struct BJumblrURIs
 	LV2_URID notify_messageEvent;
 	LV2_URID notify_message;
 	LV2_URID notify_waveformEvent;
-	LV2_URID notify_waveformStart;
-	LV2_URID notify_waveformData;
+	LV2_URID notify_waveformEnvelope;
 };
 
 void getURIs (LV2_URID_Map* m, BJumblrURIs* uris)
@@ -97,6 +112,8 @@ void getURIs (LV2_URID_Map* m, BJumblrURIs* uris)
 	uris->atom_Double = m->map(m->handle, LV2_ATOM__Double);
 	uris->atom_Bool = m->map(m->handle, LV2_ATOM__Bool);
 	uris->atom_Int = m->map(m->handle, LV2_ATOM__Int);
+	uris->bufsz_maxBlockLength = m->map(m->handle, LV2_BUF_SIZE__maxBlockLength);
+	uris->bufsz_nominalBlockLength = m->map(m->handle, LV2_BUF_SIZE__nominalBlockLength);
 	uris->atom_Object = m->map(m->handle, LV2_ATOM__Object);
 	uris->atom_Blank = m->map(m->handle, LV2_ATOM__Blank);
 	uris->atom_eventTransfer = m->map(m->handle, LV2_ATOM__eventTransfer);
@@ -104,6 +121,7 @@ void getURIs (LV2_URID_Map* m, BJumblrURIs* uris)
 	uris->atom_Long = m->map (m->handle, LV2_ATOM__Long);
 	uris->atom_String = m->map (m->handle, LV2_ATOM__String);
 	uris->atom_Path = m->map(m->handle, LV2_ATOM__Path);
+	uris->atom_Chunk = m->map(m->handle, LV2_ATOM__Chunk);
 	uris->time_Position = m->map(m->handle, LV2_TIME__Position);
 	uris->time_bar = m->map(m->handle, LV2_TIME__bar);
 	uris->time_barBeat = m->map(m->handle, LV2_TIME__barBeat);
@@ -116,6 +134,7 @@ void getURIs (LV2_URID_Map* m, BJumblrURIs* uris)
 	uris->ui_on = m->map(m->handle, BJUMBLR_URI "#UIon");
 	uris->ui_off = m->map(m->handle, BJUMBLR_URI "#UIoff");
 	uris->state_pad = m->map(m->handle, BJUMBLR_URI "#STATEpad");
+	uris->state_patternChunk = m->map(m->handle, BJUMBLR_URI "#STATEpatternChunk");
 	uris->notify_padEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYpadEvent");
 	uris->notify_padPage = m->map(m->handle, BJUMBLR_URI "#NOTIFYpadPage");
 	uris->notify_pad = m->map(m->handle, BJUMBLR_URI "#NOTIFYpad");
@@ -124,6 +143,17 @@ void getURIs (LV2_URID_Map* m, BJumblrURIs* uris)
 	uris->notify_editMode = m->map(m->handle, BJUMBLR_URI "#NOTIFYeditMode");
 	uris->notify_sampleFreeEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYsampleFreeEvent");
 	uris->notify_installSample = m->map(m->handle, BJUMBLR_URI "#NOTIFYinstallSample");
+	uris->notify_buildSchedule = m->map(m->handle, BJUMBLR_URI "#NOTIFYbuildSchedule");
+	uris->notify_installSchedule = m->map(m->handle, BJUMBLR_URI "#NOTIFYinstallSchedule");
+	uris->notify_buildWaveform = m->map(m->handle, BJUMBLR_URI "#NOTIFYbuildWaveform");
+	uris->notify_installWaveform = m->map(m->handle, BJUMBLR_URI "#NOTIFYinstallWaveform");
+	uris->notify_resizeHistory = m->map(m->handle, BJUMBLR_URI "#NOTIFYresizeHistory");
+	uris->notify_installHistory = m->map(m->handle, BJUMBLR_URI "#NOTIFYinstallHistory");
+	uris->notify_historyFreeEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYhistoryFreeEvent");
+	uris->notify_patternFreeEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYpatternFreeEvent");
+	uris->notify_drainLog = m->map(m->handle, BJUMBLR_URI "#NOTIFYdrainLog");
+	uris->notify_traceEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYtraceEvent");
+	uris->notify_tracePath = m->map(m->handle, BJUMBLR_URI "#NOTIFYtracePath");
 	uris->notify_pathEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYpathEvent");
 	uris->notify_samplePath = m->map(m->handle, BJUMBLR_URI "#NOTIFYsamplePath");
 	uris->notify_sampleStart = m->map(m->handle, BJUMBLR_URI "#NOTIFYsampleStart");
@@ -141,8 +171,7 @@ void getURIs (LV2_URID_Map* m, BJumblrURIs* uris)
 	uris->notify_messageEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYmessageEvent");
 	uris->notify_message = m->map(m->handle, BJUMBLR_URI "#NOTIFYmessage");
 	uris->notify_waveformEvent = m->map(m->handle, BJUMBLR_URI "#NOTIFYwaveformEvent");
-	uris->notify_waveformStart = m->map(m->handle, BJUMBLR_URI "#NOTIFYwaveformStart");
-	uris->notify_waveformData = m->map(m->handle, BJUMBLR_URI "#NOTIFYwaveformData");
+	uris->notify_waveformEnvelope = m->map(m->handle, BJUMBLR_URI "#NOTIFYwaveformEnvelope");
 }
 
 #endif /* URIDS_HPP_ */
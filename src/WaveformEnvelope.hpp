@@ -0,0 +1,150 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef WAVEFORMENVELOPE_HPP_
+#define WAVEFORMENVELOPE_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include "definitions.h"
+
+#define WAVEFORM_BITS 8		// Quantization of the transported envelope, 8 or 16
+
+/*
+ * Min/max envelope of the signal in a waveform slot.
+ */
+struct EnvelopeSlot
+{
+	float min;
+	float max;
+};
+
+/*
+ * Waveform transport (DSP -> GUI) as atom:Chunk: this header followed by
+ * size min/max pairs of signed bits-wide integers relative to scale. The
+ * slots start at start and wrap around at WAVEFORMSIZE.
+ */
+struct WaveformEnvelopeHeader
+{
+	uint16_t start;
+	uint16_t size;
+	uint8_t bits;
+	uint8_t reserved[3];
+	float scale;
+};
+
+inline uint32_t getWaveformEnvelopeSize (const int size, const int bits)
+{
+	return sizeof (WaveformEnvelopeHeader) + size * 2 * (bits / 8);
+}
+
+/*
+ * Encodes size slots of the ring of WAVEFORMSIZE slots starting at start.
+ * The scale is the max. absolute value of the encoded slots. Min values
+ * are rounded down and max values up, thus quantization never hides
+ * peaks.
+ * @param slots		Ring of WAVEFORMSIZE slots
+ * @param start		First slot
+ * @param size		Number of slots (1..WAVEFORMSIZE)
+ * @param bits		8 or 16
+ * @param data		Output, getWaveformEnvelopeSize (size, bits) bytes
+ */
+inline void encodeWaveformEnvelope (const EnvelopeSlot* slots, const int start, const int size, const int bits, uint8_t* data)
+{
+	float scale = 0.0f;
+	for (int i = 0; i < size; ++i)
+	{
+		const EnvelopeSlot& s = slots[(start + i) % WAVEFORMSIZE];
+		scale = std::max (scale, std::max (fabsf (s.min), fabsf (s.max)));
+	}
+
+	WaveformEnvelopeHeader header = {uint16_t (start), uint16_t (size), uint8_t (bits), {0, 0, 0}, scale};
+	memcpy (data, &header, sizeof (header));
+
+	const float qmax = (bits == 16 ? 32767.0f : 127.0f);
+	const float f = (scale > 0.0f ? qmax / scale : 0.0f);
+	uint8_t* d = data + sizeof (header);
+	for (int i = 0; i < size; ++i)
+	{
+		const EnvelopeSlot& s = slots[(start + i) % WAVEFORMSIZE];
+		const float q[2] = {std::max (floorf (s.min * f), -qmax), std::min (ceilf (s.max * f), qmax)};
+		for (const float v : q)
+		{
+			if (bits == 16)
+			{
+				const int16_t iv = int16_t (v);
+				memcpy (d, &iv, sizeof (iv));
+				d += sizeof (iv);
+			}
+			else
+			{
+				*d = uint8_t (int8_t (v));
+				++d;
+			}
+		}
+	}
+}
+
+/*
+ * Decodes a waveform transport chunk into a ring of WAVEFORMSIZE slots.
+ * @param data		Chunk data
+ * @param dataSize	Chunk size in bytes
+ * @param slots		Output, ring of WAVEFORMSIZE slots
+ * @param start		Output, first decoded slot
+ * @param size		Output, number of decoded slots
+ * @return		False if the chunk is invalid
+ */
+inline bool decodeWaveformEnvelope (const uint8_t* data, const uint32_t dataSize, EnvelopeSlot* slots, int& start, int& size)
+{
+	if (dataSize < sizeof (WaveformEnvelopeHeader)) return false;
+
+	WaveformEnvelopeHeader header;
+	memcpy (&header, data, sizeof (header));
+	if ((header.bits != 8) && (header.bits != 16)) return false;
+	if ((header.start >= WAVEFORMSIZE) || (header.size > WAVEFORMSIZE)) return false;
+	if (dataSize < getWaveformEnvelopeSize (header.size, header.bits)) return false;
+
+	const float f = header.scale / (header.bits == 16 ? 32767.0f : 127.0f);
+	const uint8_t* d = data + sizeof (header);
+	for (int i = 0; i < header.size; ++i)
+	{
+		EnvelopeSlot& s = slots[(header.start + i) % WAVEFORMSIZE];
+		if (header.bits == 16)
+		{
+			int16_t iv[2];
+			memcpy (iv, d, sizeof (iv));
+			d += sizeof (iv);
+			s = {iv[0] * f, iv[1] * f};
+		}
+		else
+		{
+			s = {int8_t (d[0]) * f, int8_t (d[1]) * f};
+			d += 2;
+		}
+	}
+
+	start = header.start;
+	size = header.size;
+	return true;
+}
+
+#endif /* WAVEFORMENVELOPE_HPP_ */
@@ -24,7 +24,11 @@
 #define MAXPAGES 16
 #define MAXSTEPS 32
 #define WAVEFORMSIZE 1024
+#define MAXCHANNELS 6
 #define BJUMBLR_URI "https://www.jahnichen.de/plugins/lv2/BJumblr"
+#define BJUMBLR_MONO_URI BJUMBLR_URI "Mono"
+#define BJUMBLR_QUAD_URI BJUMBLR_URI "Quad"
+#define BJUMBLR_51_URI BJUMBLR_URI "51"
 #define BJUMBLR_GUI_URI "https://www.jahnichen.de/plugins/lv2/BJumblr#gui"
 
 #ifndef LIMIT
@@ -0,0 +1,151 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef LEGACYPATTERNTEXT_HPP_
+#define LEGACYPATTERNTEXT_HPP_
+
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include "definitions.h"
+#include "Pad.hpp"
+
+/*
+ * Former parser for the legacy text pattern state, taken from
+ * BJumblr::state_restore () before parsePatternText (). Only used as
+ * reference by the tests and benchmarks.
+ */
+inline void parsePatternTextLegacy (const char* text, Pad (*pads) [MAXSTEPS] [MAXSTEPS], int& nrPages)
+{
+	std::string padDataString = text;
+	const std::string keywords[3] = {"pg:", "id:", "lv:"};
+
+	// Restore pads
+	// Parse retrieved data
+	while (!padDataString.empty())
+	{
+		// Look for optional "pg:"
+		int page = 0;
+		size_t strPos = padDataString.find (keywords[0]);
+		size_t nextPos = 0;
+		if ((strPos != std::string::npos) && (strPos + 3 <= padDataString.length()))
+		{
+			padDataString.erase (0, strPos + 3);
+			int p;
+			try {p = std::stof (padDataString, &nextPos);}
+			catch  (const std::exception& e)
+			{
+				fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Can't parse page from \"%s...\"", padDataString.substr (0, 63).c_str());
+				break;
+			}
+
+			if (nextPos > 0) padDataString.erase (0, nextPos);
+			if ((p < 0) || (p >= MAXPAGES))
+			{
+				fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Invalid matrix data block loaded with page %i. Try to use the data before this page.\n", p);
+				break;
+			}
+			if (p >= nrPages) nrPages = p + 1;
+			page = p;
+		}
+
+		// Look for "id:"
+		strPos = padDataString.find (keywords[1]);
+		nextPos = 0;
+		if (strPos == std::string::npos) break;	// No "id:" found => end
+		if (strPos + 3 > padDataString.length()) break;	// Nothing more after id => end
+		padDataString.erase (0, strPos + 3);
+		int id;
+		try {id = std::stof (padDataString, &nextPos);}
+		catch  (const std::exception& e)
+		{
+			fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Can't parse ID from \"%s...\"", padDataString.substr (0, 63).c_str());
+			break;
+		}
+
+		if (nextPos > 0) padDataString.erase (0, nextPos);
+		if ((id < 0) || (id >= MAXSTEPS * MAXSTEPS))
+		{
+			fprintf (stderr, "BJumblr.lv2: Restore pad state incomplete. Invalid matrix data block loaded with ID %i. Try to use the data before this id.\n", id);
+			break;
+		}
+		int row = id % MAXSTEPS;
+		int step = id / MAXSTEPS;
+
+		// Look for pad data
+		for (int i = 2; i < 3; ++i)
+		{
+			strPos = padDataString.find (keywords[i]);
+			if (strPos == std::string::npos) continue;	// Keyword not found => next keyword
+			if (strPos + 3 >= padDataString.length())	// Nothing more after keyword => end
+			{
+				padDataString ="";
+				break;
+			}
+			if (strPos > 0) padDataString.erase (0, strPos + 3);
+			float val;
+			try {val = std::stof (padDataString, &nextPos);}
+			catch  (const std::exception& e)
+			{
+				fprintf (stderr, "BJumblr.lv2: Restore padstate incomplete. Can't parse %s from \"%s...\"",
+						 keywords[i].substr(0,2).c_str(), padDataString.substr (0, 63).c_str());
+				break;
+			}
+
+			if (nextPos > 0) padDataString.erase (0, nextPos);
+			switch (i) {
+			case 2:	pads[page][row][step].level = val;
+				break;
+			default:break;
+			}
+		}
+	}
+}
+
+/*
+ * Writes pages of pads in the legacy text format (like the former
+ * BJumblr::state_save ()).
+ */
+inline std::string writePatternTextLegacy (Pad (*pads) [MAXSTEPS] [MAXSTEPS], const int nrPages)
+{
+	std::string text = "\nMatrix data:\n";
+
+	for (int page = 0; page < nrPages; ++page)
+	{
+		for (int step = 0; step < MAXSTEPS; ++step)
+		{
+			for (int row = 0; row < MAXSTEPS; ++row)
+			{
+				Pad* pd = &pads[page][row][step];
+				if (*pd != Pad())
+				{
+					char valueString[64];
+					int id = step * MAXSTEPS + row;
+					snprintf (valueString, 62, "pg:%d; id:%d; lv:%f;\n", page, id, pd->level);
+					text += valueString;
+				}
+			}
+		}
+	}
+
+	return text;
+}
+
+#endif /* LEGACYPATTERNTEXT_HPP_ */
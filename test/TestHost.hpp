@@ -0,0 +1,295 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef TESTHOST_HPP_
+#define TESTHOST_HPP_
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <dlfcn.h>
+#include <lv2/lv2plug.in/ns/lv2core/lv2.h>
+#include <lv2/lv2plug.in/ns/ext/urid/urid.h>
+#include "lv2/lv2plug.in/ns/ext/worker/worker.h"
+#include <lv2/lv2plug.in/ns/ext/state/state.h>
+#include <lv2/lv2plug.in/ns/ext/options/options.h>
+#include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
+#include <lv2/lv2plug.in/ns/ext/atom/atom.h>
+
+#define TESTHOST_QUEUE_SLOTS 64
+#define TESTHOST_QUEUE_SLOTSIZE 4096
+
+/*
+ * Fixed size queue of worker messages. Doesn't allocate after construction,
+ * thus it can be used from run () and work_response () like the ring
+ * buffers of real hosts.
+ */
+class WorkQueue
+{
+public:
+	WorkQueue () : data (TESTHOST_QUEUE_SLOTS * TESTHOST_QUEUE_SLOTSIZE), sizes (TESTHOST_QUEUE_SLOTS), head (0), tail (0) {}
+
+	bool push (const uint32_t size, const void* msg)
+	{
+		if ((size > TESTHOST_QUEUE_SLOTSIZE) || (head - tail >= TESTHOST_QUEUE_SLOTS)) return false;
+		const uint32_t slot = head % TESTHOST_QUEUE_SLOTS;
+		memcpy (&data[slot * TESTHOST_QUEUE_SLOTSIZE], msg, size);
+		sizes[slot] = size;
+		++head;
+		return true;
+	}
+
+	bool empty () const {return head == tail;}
+
+	uint32_t frontSize () const {return sizes[tail % TESTHOST_QUEUE_SLOTS];}
+
+	const void* front () const {return &data[(tail % TESTHOST_QUEUE_SLOTS) * TESTHOST_QUEUE_SLOTSIZE];}
+
+	void pop () {++tail;}
+
+	void clear () {tail = head;}
+
+private:
+	std::vector<uint8_t> data;
+	std::vector<uint32_t> sizes;
+	uint32_t head;
+	uint32_t tail;
+};
+
+/*
+ * Minimal headless LV2 host for the test programs. Loads a plugin binary
+ * (e.g., BJumblr.lv2/BJumblr.so) and provides the features required by
+ * B.Jumblr: urid:map, urid:unmap, work:schedule and the block length
+ * options. Scheduled work is queued and executed by work () in the
+ * calling thread. State is saved to and restored from a property map.
+ */
+class TestHost
+{
+public:
+	TestHost (const int blockLength = 256) :
+		library (nullptr), descriptorFunction (nullptr),
+		uridMap {this, mapUri}, uridUnmap {this, unmapUri}, workerSchedule {this, scheduleWork},
+		mapPath {this, abstractPath, absolutePath},
+		blockLength (blockLength), options (), features (), stateFeatures (), workQueue (), responseQueue (), properties ()
+	{
+		uris.push_back ("");	// URID 0 is invalid
+
+		options[0] = LV2_Options_Option {LV2_OPTIONS_INSTANCE, 0, map (LV2_BUF_SIZE__maxBlockLength), sizeof (int32_t), map (LV2_ATOM__Int), &this->blockLength};
+		options[1] = LV2_Options_Option {LV2_OPTIONS_INSTANCE, 0, map (LV2_BUF_SIZE__nominalBlockLength), sizeof (int32_t), map (LV2_ATOM__Int), &this->blockLength};
+		options[2] = LV2_Options_Option {LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, nullptr};
+
+		featureData[0] = LV2_Feature {LV2_URID__map, &uridMap};
+		featureData[1] = LV2_Feature {LV2_URID__unmap, &uridUnmap};
+		featureData[2] = LV2_Feature {LV2_WORKER__schedule, &workerSchedule};
+		featureData[3] = LV2_Feature {LV2_OPTIONS__options, options};
+		for (int i = 0; i < 4; ++i) features[i] = &featureData[i];
+		features[4] = nullptr;
+
+		featureData[4] = LV2_Feature {LV2_STATE__mapPath, &mapPath};
+		stateFeatures[0] = &featureData[4];
+		stateFeatures[1] = nullptr;
+	}
+
+	TestHost (const TestHost& that) = delete;
+
+	TestHost& operator= (const TestHost& that) = delete;
+
+	~TestHost () {if (library) dlclose (library);}
+
+	/*
+	 * Loads the plugin binary.
+	 * @param path		Path to the plugin shared object
+	 * @return		True on success
+	 */
+	bool load (const char* path)
+	{
+		library = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+		if (!library)
+		{
+			fprintf (stderr, "Can't load %s: %s\n", path, dlerror ());
+			return false;
+		}
+
+		descriptorFunction = (LV2_Descriptor_Function) dlsym (library, "lv2_descriptor");
+		if (!descriptorFunction)
+		{
+			fprintf (stderr, "%s is not an LV2 plugin.\n", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	/*
+	 * Returns the descriptor of the plugin with the URI uri or nullptr.
+	 */
+	const LV2_Descriptor* getDescriptor (const char* uri) const
+	{
+		if (!descriptorFunction) return nullptr;
+		for (uint32_t i = 0; const LV2_Descriptor* d = descriptorFunction (i); ++i)
+		{
+			if (!strcmp (d->URI, uri)) return d;
+		}
+		return nullptr;
+	}
+
+	LV2_Handle instantiate (const LV2_Descriptor* descriptor, const double rate)
+	{
+		return descriptor->instantiate (descriptor, rate, "", features);
+	}
+
+	LV2_URID map (const char* uri)
+	{
+		for (size_t i = 1; i < uris.size (); ++i)
+		{
+			if (uris[i] == uri) return i;
+		}
+		uris.push_back (uri);
+		return uris.size () - 1;
+	}
+
+	const char* unmap (const LV2_URID urid) const {return (urid < uris.size () ? uris[urid].c_str () : nullptr);}
+
+	LV2_URID_Map* getMap () {return &uridMap;}
+
+	int getBlockLength () const {return blockLength;}
+
+	/*
+	 * Executes all scheduled work. Responses are queued until
+	 * deliverResponses ().
+	 * @return		Number of executed work items
+	 */
+	int work (const LV2_Descriptor* descriptor, LV2_Handle instance)
+	{
+		const LV2_Worker_Interface* iface = (const LV2_Worker_Interface*) descriptor->extension_data (LV2_WORKER__interface);
+		int nr = 0;
+		for (; !workQueue.empty (); ++nr)
+		{
+			iface->work (instance, respond, this, workQueue.frontSize (), workQueue.front ());
+			workQueue.pop ();
+		}
+		return nr;
+	}
+
+	/*
+	 * Calls work_response () for all queued responses and end_run ().
+	 * @return		Number of delivered responses
+	 */
+	int deliverResponses (const LV2_Descriptor* descriptor, LV2_Handle instance)
+	{
+		const LV2_Worker_Interface* iface = (const LV2_Worker_Interface*) descriptor->extension_data (LV2_WORKER__interface);
+		int nr = 0;
+		for (; !responseQueue.empty (); ++nr)
+		{
+			iface->work_response (instance, responseQueue.frontSize (), responseQueue.front ());
+			responseQueue.pop ();
+		}
+		if (iface->end_run) iface->end_run (instance);
+		return nr;
+	}
+
+	/*
+	 * Removes all scheduled work and queued responses.
+	 */
+	void clearWork ()
+	{
+		workQueue.clear ();
+		responseQueue.clear ();
+	}
+
+	LV2_State_Status saveState (const LV2_Descriptor* descriptor, LV2_Handle instance)
+	{
+		const LV2_State_Interface* iface = (const LV2_State_Interface*) descriptor->extension_data (LV2_STATE__interface);
+		properties.clear ();
+		return iface->save (instance, storeProperty, this, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE, stateFeatures);
+	}
+
+	LV2_State_Status restoreState (const LV2_Descriptor* descriptor, LV2_Handle instance)
+	{
+		const LV2_State_Interface* iface = (const LV2_State_Interface*) descriptor->extension_data (LV2_STATE__interface);
+		return iface->restore (instance, retrieveProperty, this, 0, stateFeatures);
+	}
+
+protected:
+	struct Property
+	{
+		uint32_t type;
+		uint32_t flags;
+		std::vector<uint8_t> value;
+	};
+	static LV2_URID mapUri (void* handle, const char* uri) {return ((TestHost*) handle)->map (uri);}
+
+	static const char* unmapUri (void* handle, LV2_URID urid) {return ((TestHost*) handle)->unmap (urid);}
+
+	static LV2_Worker_Status scheduleWork (void* handle, uint32_t size, const void* data)
+	{
+		return (((TestHost*) handle)->workQueue.push (size, data) ? LV2_WORKER_SUCCESS : LV2_WORKER_ERR_NO_SPACE);
+	}
+
+	static LV2_Worker_Status respond (void* handle, uint32_t size, const void* data)
+	{
+		return (((TestHost*) handle)->responseQueue.push (size, data) ? LV2_WORKER_SUCCESS : LV2_WORKER_ERR_NO_SPACE);
+	}
+
+	// Paths are stored unchanged
+	static char* abstractPath (void* handle, const char* path) {return strdup (path);}
+
+	static char* absolutePath (void* handle, const char* path) {return strdup (path);}
+
+	static LV2_State_Status storeProperty (void* handle, uint32_t key, const void* value, size_t size, uint32_t type, uint32_t flags)
+	{
+		const uint8_t* v = (const uint8_t*) value;
+		((TestHost*) handle)->properties[key] = Property {type, flags, std::vector<uint8_t> (v, v + size)};
+		return LV2_STATE_SUCCESS;
+	}
+
+	static const void* retrieveProperty (void* handle, uint32_t key, size_t* size, uint32_t* type, uint32_t* flags)
+	{
+		const std::map<uint32_t, Property>& properties = ((TestHost*) handle)->properties;
+		std::map<uint32_t, Property>::const_iterator it = properties.find (key);
+		if (it == properties.end ()) return nullptr;
+		*size = it->second.value.size ();
+		*type = it->second.type;
+		*flags = it->second.flags;
+		return it->second.value.data ();
+	}
+
+	void* library;
+	LV2_Descriptor_Function descriptorFunction;
+	std::vector<std::string> uris;
+	LV2_URID_Map uridMap;
+	LV2_URID_Unmap uridUnmap;
+	LV2_Worker_Schedule workerSchedule;
+	LV2_State_Map_Path mapPath;
+	int32_t blockLength;
+	LV2_Options_Option options[3];
+	LV2_Feature featureData[5];
+	const LV2_Feature* features[5];
+	const LV2_Feature* stateFeatures[2];
+	WorkQueue workQueue;
+	WorkQueue responseQueue;
+	std::map<uint32_t, Property> properties;
+};
+
+#endif /* TESTHOST_HPP_ */
@@ -0,0 +1,113 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Benchmarks instantiate () and cleanup () of B.Jumblr (stereo) at common
+ * sample rates. Takes one or more plugin binaries, e.g., the regular build
+ * and a build with -DFRAMERING_EAGER (history zero-filled on allocation)
+ * to compare both allocation strategies:
+ *
+ * bench_instantiate BJumblr.lv2/BJumblr.so test/BJumblr_eager.so
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <unistd.h>
+#include "TestHost.hpp"
+#include "definitions.h"
+
+#define BENCH_ITERATIONS 20
+
+static const double rates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+
+/*
+ * Returns the resident set size of this process in kB (0 if unknown).
+ */
+static long getResidentSize ()
+{
+	long pages = 0;
+	long resident = 0;
+	FILE* f = fopen ("/proc/self/statm", "r");
+	if (!f) return 0;
+	if (fscanf (f, "%li %li", &pages, &resident) != 2) resident = 0;
+	fclose (f);
+	return resident * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+int main (int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf (stderr, "Usage: %s PLUGIN.so [PLUGIN.so ...]\n", argv[0]);
+		return 1;
+	}
+
+	for (int a = 1; a < argc; ++a)
+	{
+		TestHost host;
+		if (!host.load (argv[a])) return 1;
+		const LV2_Descriptor* descriptor = host.getDescriptor (BJUMBLR_URI);
+		if (!descriptor)
+		{
+			fprintf (stderr, "%s doesn't provide %s.\n", argv[a], BJUMBLR_URI);
+			return 1;
+		}
+
+		printf ("%s\n", argv[a]);
+		printf ("%10s %16s %16s %16s\n", "rate", "instantiate/ms", "cleanup/ms", "resident/kB");
+
+		for (const double rate : rates)
+		{
+			double instantiateTime = 0.0;
+			double cleanupTime = 0.0;
+			long resident = 0;
+
+			for (int i = 0; i < BENCH_ITERATIONS; ++i)
+			{
+				const long r0 = getResidentSize ();
+				const auto t0 = std::chrono::steady_clock::now ();
+				LV2_Handle instance = host.instantiate (descriptor, rate);
+				const auto t1 = std::chrono::steady_clock::now ();
+				if (!instance)
+				{
+					fprintf (stderr, "Can't instantiate at %g Hz.\n", rate);
+					return 1;
+				}
+				resident += getResidentSize () - r0;
+				descriptor->cleanup (instance);
+				const auto t2 = std::chrono::steady_clock::now ();
+				host.clearWork ();
+
+				instantiateTime += std::chrono::duration<double, std::milli> (t1 - t0).count ();
+				cleanupTime += std::chrono::duration<double, std::milli> (t2 - t1).count ();
+			}
+
+			printf
+			(
+				"%10.0f %16.3f %16.3f %16li\n",
+				rate, instantiateTime / BENCH_ITERATIONS, cleanupTime / BENCH_ITERATIONS, resident / BENCH_ITERATIONS
+			);
+		}
+		printf ("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Benchmarks restoring 16 fully populated pages from the legacy text
+ * pattern state with the former parser and with parsePatternText ().
+ */
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <string>
+#include "PatternText.hpp"
+#include "LegacyPatternText.hpp"
+
+#define BENCH_ITERATIONS 10
+
+static Pad pads[MAXPAGES][MAXSTEPS][MAXSTEPS];
+static Pad restored[MAXPAGES][MAXSTEPS][MAXSTEPS];
+
+/*
+ * Returns the mean time of parser in ms.
+ */
+template <typename Parser> static double measure (Parser parser, const std::string& text)
+{
+	double sum = 0.0;
+	for (int i = 0; i < BENCH_ITERATIONS; ++i)
+	{
+		int nrPages = 1;
+		const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+		parser (text.c_str (), restored, nrPages);
+		const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now ();
+		sum += std::chrono::duration<double, std::milli> (t1 - t0).count ();
+		if (nrPages != MAXPAGES) fprintf (stderr, "Restored %i pages instead of %i.\n", nrPages, MAXPAGES);
+	}
+	return sum / BENCH_ITERATIONS;
+}
+
+int main ()
+{
+	std::mt19937 rnd (1);
+	std::uniform_real_distribution<float> dist (0.01f, 1.0f);
+	for (int p = 0; p < MAXPAGES; ++p)
+	{
+		for (int r = 0; r < MAXSTEPS; ++r)
+		{
+			for (int s = 0; s < MAXSTEPS; ++s) pads[p][r][s] = Pad (dist (rnd));
+		}
+	}
+
+	const std::string text = writePatternTextLegacy (pads, MAXPAGES);
+	printf ("Restore %i full pages (%zu kB text)\n", MAXPAGES, text.size () / 1024);
+	printf ("%20s %16s\n", "parser", "restore/ms");
+	printf ("%20s %16.3f\n", "former", measure (parsePatternTextLegacy, text));
+	printf ("%20s %16.3f\n", "parsePatternText", measure (parsePatternText, text));
+	return 0;
+}
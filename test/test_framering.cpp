@@ -0,0 +1,109 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks the history resize of BJumblr: The worker copies the history with
+ * copyHistory () while run () keeps writing to the old ring, then
+ * work_response () completes the copy with patchHistory (). Simulates the
+ * worst case (run () writes all new frames before the worker copies) for
+ * growing and shrinking rings: All frames carried over must be identical,
+ * frames written in the meantime must be patched and torn frames cleared.
+ */
+
+#include <cstdio>
+#include "FrameRing.hpp"
+
+static const int channels = 2;
+
+static float getValue (const size_t frame, const int channel) {return float (frame + 1) + 0.5f * channel;}
+
+static void write (FrameRing& ring, const size_t start, const size_t nr)
+{
+	for (size_t f = start; f < start + nr; ++f)
+	{
+		float* frame = ring.frame (f);
+		for (int c = 0; c < channels; ++c) frame[c] = getValue (f, c);
+	}
+}
+
+/*
+ * Resizes a ring of oldSize frames to newSize frames. The resize is
+ * requested at frame counter, age frames are written until it's installed.
+ * @return		True if the resized ring is correct
+ */
+static bool checkResize (const size_t oldSize, const size_t newSize, const size_t counter, const size_t age)
+{
+	FrameRing history (channels, oldSize);
+	write (history, 0, counter);
+
+	// run () writes before the worker copies (torn frames)
+	FrameRing h (channels, newSize);
+	write (history, counter, age);
+	h.copyHistory (history, counter);
+
+	// work_response ()
+	const size_t now = counter + age;
+	h.patchHistory (history, counter, now);
+
+	// Valid are frames written in the meantime (as far as the old ring
+	// still holds them) and frames of the old ring at request time which
+	// weren't overwritten until the copy. Everything else must be zero.
+	const size_t written = (age < history.size () ? age : history.size ());
+	for (size_t a = 1; (a <= h.size ()) && (a <= now); ++a)
+	{
+		const size_t f = now - a;
+		const bool valid = (a <= written) || ((a > age) && (a <= history.size ()));
+		const float* frame = h.frame (f);
+		for (int c = 0; c < channels; ++c)
+		{
+			const float expected = (valid ? getValue (f, c) : 0.0f);
+			if (frame[c] != expected)
+			{
+				fprintf (stderr, "Resize %zu -> %zu at %zu, age %zu: frame %zu channel %i is %g instead of %g\n",
+					 history.size (), h.size (), counter, age, f, c, frame[c], expected);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main ()
+{
+	const size_t sizes[][2] = {{64, 256}, {64, 128}, {128, 128}, {256, 64}, {256, 128}, {1024, 64}};
+	const size_t ages[] = {0, 1, 10, 40, 63, 64, 100, 300};
+	int checks = 0;
+	int failed = 0;
+
+	for (const auto& s : sizes)
+	{
+		for (const size_t age : ages)
+		{
+			for (const size_t counter : {size_t (30), s[0] + 7, 5 * s[0] + 33})
+			{
+				++checks;
+				if (!checkResize (s[0], s[1], counter, age)) ++failed;
+			}
+		}
+	}
+
+	printf ("History resize: %i checks, %i failed\n", checks, failed);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,148 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that all mixing kernel variants supported by this CPU produce
+ * bit-identical results to the scalar reference kernels. Covers empty
+ * runs, runs shorter than one vector, odd lengths and runs split at the
+ * end of a FrameRing (as done by BJumblr::mixTap).
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "MixKernels.hpp"
+#include "FrameRing.hpp"
+
+static const int lengths[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 100, 257};
+
+static std::vector<MixKernels> getVariants ()
+{
+	std::vector<MixKernels> variants;
+	variants.push_back (MixKernels {macScalar, macRampScalar, "scalar"});
+#ifdef MIXKERNELS_X86_64
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("sse2")) variants.push_back (MixKernels {macSse2, macRampSse2, "SSE2"});
+	if (__builtin_cpu_supports ("avx2")) variants.push_back (MixKernels {macAvx2, macRampAvx2, "AVX2"});
+	if (__builtin_cpu_supports ("avx512f")) variants.push_back (MixKernels {macAvx512, macRampAvx512, "AVX-512"});
+#endif
+	return variants;
+}
+
+static void fillRandom (std::mt19937& rnd, float* data, const size_t n)
+{
+	std::uniform_real_distribution<float> dist (-1.0f, 1.0f);
+	for (size_t i = 0; i < n; ++i) data[i] = dist (rnd);
+}
+
+/*
+ * Mixes nr stereo frames from ring (starting at frame) to dst in up to two
+ * contiguous segments, the same way as BJumblr::mixTap.
+ */
+static void mixRing (const MixKernels& k, float* dst, const FrameRing& ring, const size_t frame, const int nr, const float gain, const float gainInc)
+{
+	for (int j = 0; j < nr; )
+	{
+		const int n = std::min<size_t> (nr - j, ring.framesToEnd (frame + j));
+		if (gainInc == 0.0f) k.mac (&dst[2 * j], ring.frame (frame + j), 2 * n, gain);
+		else k.macRamp (&dst[2 * j], ring.frame (frame + j), n, gain + j * gainInc, gainInc);
+		j += n;
+	}
+}
+
+int main ()
+{
+	const std::vector<MixKernels> variants = getVariants ();
+	const MixKernels& ref = variants[0];
+	std::mt19937 rnd (1);
+	int failures = 0;
+
+	for (const MixKernels& k : variants)
+	{
+		int checks = 0;
+		int failed = 0;
+
+		for (const int n : lengths)
+		{
+			// Unaligned source and destination (offset 1)
+			std::vector<float> src (2 * n + 1);
+			std::vector<float> dst0 (2 * n + 1);
+			fillRandom (rnd, src.data (), src.size ());
+			fillRandom (rnd, dst0.data (), dst0.size ());
+
+			// mac: n floats
+			std::vector<float> expected = dst0;
+			std::vector<float> actual = dst0;
+			ref.mac (&expected[1], &src[1], n, 0.3f);
+			k.mac (&actual[1], &src[1], n, 0.3f);
+			++checks;
+			if (memcmp (expected.data (), actual.data (), expected.size () * sizeof (float)))
+			{
+				fprintf (stderr, "%s: mac differs for n = %i\n", k.name, n);
+				++failed;
+			}
+
+			// macRamp: n stereo frames
+			expected = dst0;
+			actual = dst0;
+			ref.macRamp (&expected[1], &src[1], n, 0.25f, 0.001f);
+			k.macRamp (&actual[1], &src[1], n, 0.25f, 0.001f);
+			++checks;
+			if (memcmp (expected.data (), actual.data (), expected.size () * sizeof (float)))
+			{
+				fprintf (stderr, "%s: macRamp differs for n = %i\n", k.name, n);
+				++failed;
+			}
+		}
+
+		// Runs split at the end of the ring
+		FrameRing ring (2, 64);
+		fillRandom (rnd, ring.frame (0), 2 * ring.size ());
+		for (const size_t start : {size_t (0), size_t (50), size_t (60), size_t (63), size_t (64 + 61)})
+		{
+			for (const int nr : {1, 3, 4, 9, 17, 40})
+			{
+				for (const float gainInc : {0.0f, 0.002f})
+				{
+					std::vector<float> dst0 (2 * nr);
+					fillRandom (rnd, dst0.data (), dst0.size ());
+					std::vector<float> expected = dst0;
+					std::vector<float> actual = dst0;
+					mixRing (ref, expected.data (), ring, start, nr, 0.7f, gainInc);
+					mixRing (k, actual.data (), ring, start, nr, 0.7f, gainInc);
+					++checks;
+					if (memcmp (expected.data (), actual.data (), expected.size () * sizeof (float)))
+					{
+						fprintf (stderr, "%s: ring mix differs for start = %zu, nr = %i, gainInc = %g\n", k.name, start, nr, gainInc);
+						++failed;
+					}
+				}
+			}
+		}
+
+		printf ("%s: %i checks, %i failed\n", k.name, checks, failed);
+		failures += failed;
+	}
+
+	printf ("Selected kernels: %s\n", getMixKernels ().name);
+	return (failures ? 1 : 0);
+}
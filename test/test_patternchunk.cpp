@@ -0,0 +1,201 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that decodePatternChunk () restores the pads and the number of
+ * pages of encodePatternChunk () for empty, percent and float pages, and
+ * that it rejects truncated chunks, invalid headers, unknown page
+ * encodings and non-finite levels without changing the number of pages.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <random>
+#include "PatternChunk.hpp"
+
+struct Patterns
+{
+	Pad pads[MAXPAGES][MAXSTEPS][MAXSTEPS];
+	int nrPages;
+
+	Patterns () : pads (), nrPages (1) {}
+
+	bool operator== (const Patterns& that) const
+	{
+		return (nrPages == that.nrPages) && (memcmp (pads, that.pads, sizeof (pads)) == 0);
+	}
+};
+
+static int checks = 0;
+static int failed = 0;
+
+/*
+ * Checks that chunk is decoded to expected.
+ */
+static void checkValid (const char* name, const std::vector<uint8_t>& chunk, const Patterns& expected)
+{
+	++checks;
+	Patterns p;
+	const bool ok = decodePatternChunk (chunk.data (), chunk.size (), p.pads, p.nrPages);
+	if ((!ok) || (!(p == expected)))
+	{
+		fprintf (stderr, "%s: Decoded pattern differs (%s)\n", name, ok ? "valid" : "invalid");
+		++failed;
+	}
+}
+
+/*
+ * Checks that chunk is rejected and the number of pages is kept.
+ */
+static void checkInvalid (const char* name, const std::vector<uint8_t>& chunk)
+{
+	++checks;
+	Patterns p;
+	p.nrPages = 7;
+	const bool ok = decodePatternChunk (chunk.data (), chunk.size (), p.pads, p.nrPages);
+	if (ok || (p.nrPages != 7))
+	{
+		fprintf (stderr, "%s: Expected an invalid chunk, got %s with %i pages\n", name, ok ? "valid" : "invalid", p.nrPages);
+		++failed;
+	}
+}
+
+/*
+ * Replaces the float level at byte position pos by value.
+ */
+static std::vector<uint8_t> setFloat (std::vector<uint8_t> chunk, const size_t pos, const float value)
+{
+	uint32_t bits;
+	memcpy (&bits, &value, sizeof (bits));
+	for (int b = 0; b < 4; ++b) chunk[pos + b] = uint8_t (bits >> (8 * b));
+	return chunk;
+}
+
+int main ()
+{
+	std::mt19937 rnd (1);
+	std::uniform_real_distribution<float> dist (0.0f, 1.0f);
+
+	// Page 0 empty, page 1 GUI dial levels (percent), page 2 raw floats
+	Patterns pattern;
+	pattern.nrPages = 3;
+	for (int i = 0; i < 300; ++i) pattern.pads[1][rnd () % MAXSTEPS][rnd () % MAXSTEPS] = Pad (float (double (1 + rnd () % 100) / 100.0));
+	for (int i = 0; i < 300; ++i) pattern.pads[2][rnd () % MAXSTEPS][rnd () % MAXSTEPS] = Pad (dist (rnd) + 0.001f);
+	pattern.pads[2][0][0] = Pad (-0.5f);
+	pattern.pads[2][MAXSTEPS - 1][MAXSTEPS - 1] = Pad (2.5f);
+
+	int count1 = 0;
+	for (int r = 0; r < MAXSTEPS; ++r)
+	{
+		for (int s = 0; s < MAXSTEPS; ++s) if (pattern.pads[1][r][s].level != 0.0f) ++count1;
+	}
+
+	std::vector<uint8_t> chunk;
+	encodePatternChunk (pattern.pads, pattern.nrPages, chunk);
+
+	// Layout: header, empty page, percent page, float page
+	const size_t page1 = PATTERNCHUNK_HEADER_SIZE + 1;
+	const size_t page2 = page1 + 1 + PATTERNCHUNK_BITMAP_SIZE + count1;
+	++checks;
+	if ((chunk[PATTERNCHUNK_HEADER_SIZE] != PAGE_EMPTY) || (chunk[page1] != PAGE_PERCENT) || (chunk[page2] != PAGE_FLOAT))
+	{
+		fprintf (stderr, "Unexpected page encodings\n");
+		++failed;
+		printf ("Pattern chunk: %i checks, %i failed\n", checks, failed);
+		return 1;
+	}
+
+	// Round trip
+	checkValid ("round trip", chunk, pattern);
+	{
+		Patterns empty;
+		empty.nrPages = MAXPAGES;
+		std::vector<uint8_t> emptyChunk;
+		encodePatternChunk (empty.pads, empty.nrPages, emptyChunk);
+		checkValid ("empty pages", emptyChunk, empty);
+		++checks;
+		if (emptyChunk.size () != size_t (PATTERNCHUNK_HEADER_SIZE + MAXPAGES))
+		{
+			fprintf (stderr, "empty pages: Unexpected chunk size %zu\n", emptyChunk.size ());
+			++failed;
+		}
+	}
+
+	// Truncated header, page encodings, bitmaps and level arrays
+	checkInvalid ("no data", std::vector<uint8_t> ());
+	checkInvalid ("truncated header", std::vector<uint8_t> (chunk.begin (), chunk.begin () + PATTERNCHUNK_HEADER_SIZE - 1));
+	checkInvalid ("missing pages", std::vector<uint8_t> (chunk.begin (), chunk.begin () + PATTERNCHUNK_HEADER_SIZE));
+	checkInvalid ("truncated percent bitmap", std::vector<uint8_t> (chunk.begin (), chunk.begin () + page1 + PATTERNCHUNK_BITMAP_SIZE / 2));
+	checkInvalid ("truncated percent levels", std::vector<uint8_t> (chunk.begin (), chunk.begin () + page2 - 1));
+	checkInvalid ("missing float page", std::vector<uint8_t> (chunk.begin (), chunk.begin () + page2));
+	checkInvalid ("truncated float bitmap", std::vector<uint8_t> (chunk.begin (), chunk.begin () + page2 + PATTERNCHUNK_BITMAP_SIZE));
+	checkInvalid ("truncated float level", std::vector<uint8_t> (chunk.begin (), chunk.end () - 2));
+	{
+		int truncated = 0;
+		for (size_t size = 0; size < chunk.size (); ++size)
+		{
+			Patterns p;
+			if (decodePatternChunk (chunk.data (), size, p.pads, p.nrPages)) ++truncated;
+		}
+		++checks;
+		if (truncated)
+		{
+			fprintf (stderr, "all truncations: %i truncated chunks accepted\n", truncated);
+			++failed;
+		}
+	}
+
+	// Invalid header
+	{
+		std::vector<uint8_t> c = chunk;
+		c[0] = 'b';
+		checkInvalid ("bad magic", c);
+		c = chunk;
+		c[3] = 0;
+		checkInvalid ("version 0", c);
+		c[3] = PATTERNCHUNK_VERSION + 1;
+		checkInvalid ("future version", c);
+		c = chunk;
+		c[4] = 0;
+		checkInvalid ("no pages", c);
+		c[4] = MAXPAGES + 1;
+		checkInvalid ("too many pages", c);
+		c = chunk;
+		c[5] = MAXSTEPS / 2;
+		checkInvalid ("other MAXSTEPS", c);
+		c = chunk;
+		c[page1] = PAGE_FLOAT + 1;
+		checkInvalid ("unknown page encoding", c);
+	}
+
+	// Non-finite floats
+	{
+		const size_t level = page2 + 1 + PATTERNCHUNK_BITMAP_SIZE;
+		checkInvalid ("NaN level", setFloat (chunk, level, std::numeric_limits<float>::quiet_NaN ()));
+		checkInvalid ("infinite level", setFloat (chunk, level, std::numeric_limits<float>::infinity ()));
+		checkInvalid ("negative infinite last level", setFloat (chunk, chunk.size () - 4, -std::numeric_limits<float>::infinity ()));
+	}
+
+	printf ("Pattern chunk: %i checks, %i failed\n", checks, failed);
+	return (failed ? 1 : 0);
+}
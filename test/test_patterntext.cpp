@@ -0,0 +1,203 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that parsePatternText () restores the same pads and number of
+ * pages as the former parser: full pages written by the former
+ * state_save (), text with optional or missing "pg:", levels before IDs
+ * and invalid data. The former parser stopped at invalid data while
+ * parsePatternText () skips the line, thus invalid lines are compared to
+ * the former parser with the line removed. Also checks the line numbers
+ * reported for skipped lines.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <unistd.h>
+#include "PatternText.hpp"
+#include "LegacyPatternText.hpp"
+
+struct Patterns
+{
+	Pad pads[MAXPAGES][MAXSTEPS][MAXSTEPS];
+	int nrPages;
+	int errors;
+	std::string messages;
+
+	Patterns () : pads (), nrPages (1), errors (0), messages () {}
+
+	bool operator== (const Patterns& that) const
+	{
+		return (nrPages == that.nrPages) && (memcmp (pads, that.pads, sizeof (pads)) == 0);
+	}
+};
+
+/*
+ * Runs parsePatternText () and captures its messages to stderr.
+ */
+static Patterns parse (const std::string& text)
+{
+	Patterns p;
+	fflush (stderr);
+	FILE* tmp = tmpfile ();
+	const int savedStderr = dup (fileno (stderr));
+	if (tmp) dup2 (fileno (tmp), fileno (stderr));
+
+	p.errors = parsePatternText (text.c_str (), p.pads, p.nrPages);
+
+	fflush (stderr);
+	dup2 (savedStderr, fileno (stderr));
+	close (savedStderr);
+	if (tmp)
+	{
+		rewind (tmp);
+		char buffer[256];
+		while (fgets (buffer, sizeof (buffer), tmp)) p.messages += buffer;
+		fclose (tmp);
+	}
+	return p;
+}
+
+static Patterns parseLegacy (const std::string& text)
+{
+	Patterns p;
+	fflush (stderr);
+	FILE* tmp = tmpfile ();
+	const int savedStderr = dup (fileno (stderr));
+	if (tmp) dup2 (fileno (tmp), fileno (stderr));
+
+	parsePatternTextLegacy (text.c_str (), p.pads, p.nrPages);
+
+	fflush (stderr);
+	dup2 (savedStderr, fileno (stderr));
+	close (savedStderr);
+	if (tmp) fclose (tmp);
+	return p;
+}
+
+/*
+ * Removes line nr (1-based) from text.
+ */
+static std::string removeLine (const std::string& text, const int nr)
+{
+	size_t begin = 0;
+	for (int i = 1; (i < nr) && (begin != std::string::npos); ++i)
+	{
+		begin = text.find ('\n', begin);
+		if (begin != std::string::npos) ++begin;
+	}
+	if (begin == std::string::npos) return text;
+	const size_t end = text.find ('\n', begin);
+	return text.substr (0, begin) + (end == std::string::npos ? "" : text.substr (end + 1));
+}
+
+static int checks = 0;
+static int failed = 0;
+
+/*
+ * Compares parsePatternText () with the former parser for valid text.
+ */
+static void checkValid (const char* name, const std::string& text)
+{
+	++checks;
+	const Patterns p = parse (text);
+	const Patterns l = parseLegacy (text);
+	if ((!(p == l)) || p.errors)
+	{
+		fprintf (stderr, "%s: Differs from the former parser (%i errors)\n", name, p.errors);
+		++failed;
+	}
+}
+
+/*
+ * Checks text with one invalid line: Only this line is skipped and reported
+ * with its line number.
+ */
+static void checkInvalid (const char* name, const std::string& text, const int line, const char* error)
+{
+	++checks;
+	const Patterns p = parse (text);
+	const Patterns l = parseLegacy (removeLine (text, line));
+	const std::string message = std::string (error) + " in line " + std::to_string (line) + ".";
+	if ((!(p == l)) || (p.errors != 1) || (p.messages.find (message) == std::string::npos))
+	{
+		fprintf (stderr, "%s: Expected \"%s\" and the former result without this line, got %i errors: %s", name, message.c_str (), p.errors, p.messages.c_str ());
+		++failed;
+	}
+}
+
+int main ()
+{
+	std::mt19937 rnd (1);
+	std::uniform_real_distribution<float> dist (0.0f, 1.0f);
+
+	// Full and sparse pages as written by the former state_save ()
+	{
+		Patterns full;
+		full.nrPages = MAXPAGES;
+		for (int p = 0; p < MAXPAGES; ++p)
+		{
+			for (int r = 0; r < MAXSTEPS; ++r)
+			{
+				for (int s = 0; s < MAXSTEPS; ++s) full.pads[p][r][s] = Pad (dist (rnd));
+			}
+		}
+		checkValid ("16 full pages", writePatternTextLegacy (full.pads, full.nrPages));
+
+		Patterns sparse;
+		sparse.nrPages = 5;
+		for (int i = 0; i < 200; ++i) sparse.pads[rnd () % 5][rnd () % MAXSTEPS][rnd () % MAXSTEPS] = Pad (dist (rnd));
+		checkValid ("sparse pages", writePatternTextLegacy (sparse.pads, sparse.nrPages));
+	}
+
+	// Optional or missing "pg:"
+	checkValid ("no pg", "id:1; lv:0.5;\nid:40; lv:0.25;\nid:1023; lv:1.000000;\n");
+	checkValid ("pg in some lines", "id:1; lv:0.5;\npg:2; id:40; lv:0.25;\nid:41; lv:0.75;\npg:1; id:3; lv:1.0;\nid:7; lv:0.125;\n");
+	checkValid ("pg in last line only", "id:1; lv:0.5;\nid:2; lv:0.5;\npg:3; id:4; lv:1.0;\n");
+	checkValid ("pg after id", "id:5; pg:1; lv:0.5;\npg:2; id:6; lv:0.75;\n");
+	checkValid ("repeated pg", "pg:1; pg:2; id:7; lv:0.5;\n");
+	checkValid ("pg without id", "pg:1; id:3; lv:0.5;\npg:4;\n");
+	checkValid ("empty", "");
+	checkValid ("header only", "\nMatrix data:\n");
+
+	// Level before ID, missing levels, odd number formats
+	checkValid ("level before id", "pg:0; lv:0.5; id:3;\npg:0; id:4; lv:0.7;\n");
+	checkValid ("level before id, last line", "pg:1; id:3; lv:0.2;\npg:1; lv:0.5; id:9;\n");
+	checkValid ("id without level", "pg:0; id:3;\npg:0; id:4; lv:0.7;\n");
+	checkValid ("two levels", "pg:0; id:3; lv:0.1; lv:0.2;\npg:0; id:4; lv:0.3;\n");
+	checkValid ("short separators", "pg:1;id:2;lv:0.5\npg:1;id:3;lv:0.25");
+	checkValid ("float page and id", "pg:1.7; id:33.9; lv:0.5;\npg:-0.5; id:-0.25; lv:0.75;\n");
+	checkValid ("whitespace", "pg: 2; id:  5; lv:\t0.5;\r\n");
+
+	// Invalid data
+	checkInvalid ("invalid page", "pg:0; id:1; lv:0.5;\npg:16; id:2; lv:0.5;\npg:1; id:3; lv:0.5;\n", 2, "Invalid page");
+	checkInvalid ("negative page", "pg:0; id:1; lv:0.5;\npg:0; id:2; lv:0.5;\npg:-1; id:3; lv:0.5;\npg:2; id:4; lv:0.5;\n", 3, "Invalid page");
+	checkInvalid ("invalid id", "pg:0; id:1; lv:0.5;\npg:0; id:1024; lv:0.5;\npg:1; id:3; lv:0.5;\n", 2, "Invalid ID");
+	checkInvalid ("unparsable page", "\nMatrix data:\npg:x; id:1; lv:0.5;\npg:1; id:3; lv:0.5;\n", 3, "Can't parse page");
+	checkInvalid ("unparsable id", "pg:0; id:1; lv:0.5;\npg:0; id:?; lv:0.5;\npg:1; id:3; lv:0.5;\n", 2, "Can't parse ID");
+	checkInvalid ("unparsable level", "pg:0; id:1; lv:0.5;\npg:0; id:2; lv:abc;\npg:1; id:3; lv:0.5;\n", 2, "Can't parse level");
+	checkInvalid ("truncated level", "pg:1; id:3; lv:0.5;\npg:1; id:4; lv:", 2, "Can't parse level");
+
+	printf ("Pattern text: %i checks, %i failed\n", checks, failed);
+	return (failed ? 1 : 0);
+}
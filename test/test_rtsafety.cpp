@@ -0,0 +1,787 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * RT-safety test host. Loads B.Jumblr (stereo) headless and runs it through
+ * pattern edits, page switches, MIDI page triggers, MIDI learn, sample
+ * hot-swap, state save / restore and history resizes. Calls to the memory
+ * allocator, to locking functions and to file I/O functions from within
+ * run () or work_response () are intercepted and make the test fail:
+ *
+ * test_rtsafety BJumblr.lv2/BJumblr.so
+ *
+ * The interceptors replace the glibc and libstdc++ functions for the whole
+ * process (including the dlopened plugin), thus link with -rdynamic. The
+ * worker, state_save () and state_restore () run outside the checked context
+ * like in a real host.
+ */
+
+#undef _FORTIFY_SOURCE
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <lv2/lv2plug.in/ns/ext/atom/forge.h>
+#include "TestHost.hpp"
+#include "Urids.hpp"
+#include "Ports.hpp"
+#include "PadMessage.hpp"
+#include "definitions.h"
+
+#define MAX_VIOLATIONS 64
+#define BLOCK_LENGTH 256
+#define CONTROL_SIZE 65536
+#define NOTIFY_SIZE 65536
+
+/*
+ * Violation bookkeeping. Must not allocate, lock or write itself.
+ */
+struct Violation
+{
+	const char* step;
+	const char* function;
+};
+
+static std::atomic<bool> rtContext (false);
+static const char* currentStep = "";
+static Violation violations[MAX_VIOLATIONS];
+static int nrDistinctViolations = 0;
+static int nrViolations = 0;
+
+static void check (const char* function)
+{
+	if (!rtContext.load (std::memory_order_relaxed)) return;
+	++nrViolations;
+
+	// Keep distinct step / function pairs only
+	for (int i = 0; i < nrDistinctViolations; ++i)
+	{
+		if ((violations[i].step == currentStep) && (violations[i].function == function)) return;
+	}
+	if (nrDistinctViolations < MAX_VIOLATIONS) violations[nrDistinctViolations++] = Violation {currentStep, function};
+}
+
+/*
+ * Interceptors. Memory functions forward to the glibc internals, all other
+ * functions to the next definition (libc).
+ */
+extern "C"
+{
+void* __libc_malloc (size_t size);
+void* __libc_calloc (size_t nmemb, size_t size);
+void* __libc_realloc (void* ptr, size_t size);
+void* __libc_memalign (size_t alignment, size_t size);
+void __libc_free (void* ptr);
+
+void* malloc (size_t size) noexcept
+{
+	check ("malloc");
+	return __libc_malloc (size);
+}
+
+void* calloc (size_t nmemb, size_t size) noexcept
+{
+	check ("calloc");
+	return __libc_calloc (nmemb, size);
+}
+
+void* realloc (void* ptr, size_t size) noexcept
+{
+	check ("realloc");
+	return __libc_realloc (ptr, size);
+}
+
+void* memalign (size_t alignment, size_t size) noexcept
+{
+	check ("memalign");
+	return __libc_memalign (alignment, size);
+}
+
+void* aligned_alloc (size_t alignment, size_t size) noexcept
+{
+	check ("aligned_alloc");
+	return __libc_memalign (alignment, size);
+}
+
+int posix_memalign (void** ptr, size_t alignment, size_t size) noexcept
+{
+	check ("posix_memalign");
+	void* p = __libc_memalign (alignment, size);
+	if (!p) return ENOMEM;
+	*ptr = p;
+	return 0;
+}
+
+void free (void* ptr) noexcept
+{
+	if (!ptr) return;
+	check ("free");
+	__libc_free (ptr);
+}
+}
+
+void* operator new (size_t size)
+{
+	check ("operator new");
+	void* p = __libc_malloc (size);
+	if (!p) throw std::bad_alloc ();
+	return p;
+}
+
+void* operator new[] (size_t size)
+{
+	check ("operator new[]");
+	void* p = __libc_malloc (size);
+	if (!p) throw std::bad_alloc ();
+	return p;
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept
+{
+	check ("operator new");
+	return __libc_malloc (size);
+}
+
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept
+{
+	check ("operator new[]");
+	return __libc_malloc (size);
+}
+
+void operator delete (void* ptr) noexcept
+{
+	if (!ptr) return;
+	check ("operator delete");
+	__libc_free (ptr);
+}
+
+void operator delete[] (void* ptr) noexcept
+{
+	if (!ptr) return;
+	check ("operator delete[]");
+	__libc_free (ptr);
+}
+
+void operator delete (void* ptr, size_t) noexcept {operator delete (ptr);}
+
+void operator delete[] (void* ptr, size_t) noexcept {operator delete[] (ptr);}
+
+template <typename Function> static Function next (Function& function, const char* name)
+{
+	if (!function) function = (Function) dlsym (RTLD_NEXT, name);
+	return function;
+}
+
+static int (*nextMutexLock) (pthread_mutex_t*) = nullptr;
+static int (*nextMutexTrylock) (pthread_mutex_t*) = nullptr;
+static int (*nextCondWait) (pthread_cond_t*, pthread_mutex_t*) = nullptr;
+static int (*nextCondTimedwait) (pthread_cond_t*, pthread_mutex_t*, const struct timespec*) = nullptr;
+static int (*nextRwlockRdlock) (pthread_rwlock_t*) = nullptr;
+static int (*nextRwlockWrlock) (pthread_rwlock_t*) = nullptr;
+static int (*nextSemWait) (sem_t*) = nullptr;
+static FILE* (*nextFopen) (const char*, const char*) = nullptr;
+static FILE* (*nextFopen64) (const char*, const char*) = nullptr;
+static int (*nextFclose) (FILE*) = nullptr;
+static size_t (*nextFread) (void*, size_t, size_t, FILE*) = nullptr;
+static size_t (*nextFwrite) (const void*, size_t, size_t, FILE*) = nullptr;
+static int (*nextFputs) (const char*, FILE*) = nullptr;
+static int (*nextPuts) (const char*) = nullptr;
+static int (*nextFputc) (int, FILE*) = nullptr;
+static int (*nextVfprintf) (FILE*, const char*, va_list) = nullptr;
+static int (*nextOpen) (const char*, int, ...) = nullptr;
+static int (*nextOpen64) (const char*, int, ...) = nullptr;
+static int (*nextOpenat) (int, const char*, int, ...) = nullptr;
+static int (*nextClose) (int) = nullptr;
+static ssize_t (*nextRead) (int, void*, size_t) = nullptr;
+static ssize_t (*nextWrite) (int, const void*, size_t) = nullptr;
+
+/*
+ * Resolves all forwarded functions in advance. Otherwise dlsym () would be
+ * called in the checked context on first use.
+ */
+static void resolveNext ()
+{
+	next (nextMutexLock, "pthread_mutex_lock");
+	next (nextMutexTrylock, "pthread_mutex_trylock");
+	next (nextCondWait, "pthread_cond_wait");
+	next (nextCondTimedwait, "pthread_cond_timedwait");
+	next (nextRwlockRdlock, "pthread_rwlock_rdlock");
+	next (nextRwlockWrlock, "pthread_rwlock_wrlock");
+	next (nextSemWait, "sem_wait");
+	next (nextFopen, "fopen");
+	next (nextFopen64, "fopen64");
+	next (nextFclose, "fclose");
+	next (nextFread, "fread");
+	next (nextFwrite, "fwrite");
+	next (nextFputs, "fputs");
+	next (nextPuts, "puts");
+	next (nextFputc, "fputc");
+	next (nextVfprintf, "vfprintf");
+	next (nextOpen, "open");
+	next (nextOpen64, "open64");
+	next (nextOpenat, "openat");
+	next (nextClose, "close");
+	next (nextRead, "read");
+	next (nextWrite, "write");
+}
+
+extern "C"
+{
+int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+{
+	check ("pthread_mutex_lock");
+	return next (nextMutexLock, "pthread_mutex_lock") (mutex);
+}
+
+int pthread_mutex_trylock (pthread_mutex_t* mutex) noexcept
+{
+	check ("pthread_mutex_trylock");
+	return next (nextMutexTrylock, "pthread_mutex_trylock") (mutex);
+}
+
+int pthread_cond_wait (pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+	check ("pthread_cond_wait");
+	return next (nextCondWait, "pthread_cond_wait") (cond, mutex);
+}
+
+int pthread_cond_timedwait (pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* abstime)
+{
+	check ("pthread_cond_timedwait");
+	return next (nextCondTimedwait, "pthread_cond_timedwait") (cond, mutex, abstime);
+}
+
+int pthread_rwlock_rdlock (pthread_rwlock_t* rwlock) noexcept
+{
+	check ("pthread_rwlock_rdlock");
+	return next (nextRwlockRdlock, "pthread_rwlock_rdlock") (rwlock);
+}
+
+int pthread_rwlock_wrlock (pthread_rwlock_t* rwlock) noexcept
+{
+	check ("pthread_rwlock_wrlock");
+	return next (nextRwlockWrlock, "pthread_rwlock_wrlock") (rwlock);
+}
+
+int sem_wait (sem_t* sem)
+{
+	check ("sem_wait");
+	return next (nextSemWait, "sem_wait") (sem);
+}
+
+FILE* fopen (const char* path, const char* mode)
+{
+	check ("fopen");
+	return next (nextFopen, "fopen") (path, mode);
+}
+
+FILE* fopen64 (const char* path, const char* mode)
+{
+	check ("fopen64");
+	return next (nextFopen64, "fopen64") (path, mode);
+}
+
+int fclose (FILE* stream)
+{
+	check ("fclose");
+	return next (nextFclose, "fclose") (stream);
+}
+
+size_t fread (void* ptr, size_t size, size_t nmemb, FILE* stream)
+{
+	check ("fread");
+	return next (nextFread, "fread") (ptr, size, nmemb, stream);
+}
+
+size_t fwrite (const void* ptr, size_t size, size_t nmemb, FILE* stream)
+{
+	check ("fwrite");
+	return next (nextFwrite, "fwrite") (ptr, size, nmemb, stream);
+}
+
+int fputs (const char* s, FILE* stream)
+{
+	check ("fputs");
+	return next (nextFputs, "fputs") (s, stream);
+}
+
+int puts (const char* s)
+{
+	check ("puts");
+	return next (nextPuts, "puts") (s);
+}
+
+int fputc (int c, FILE* stream)
+{
+	check ("fputc");
+	return next (nextFputc, "fputc") (c, stream);
+}
+
+int vfprintf (FILE* stream, const char* format, va_list args)
+{
+	check ("vfprintf");
+	return next (nextVfprintf, "vfprintf") (stream, format, args);
+}
+
+int fprintf (FILE* stream, const char* format, ...)
+{
+	check ("fprintf");
+	va_list args;
+	va_start (args, format);
+	const int result = next (nextVfprintf, "vfprintf") (stream, format, args);
+	va_end (args);
+	return result;
+}
+
+int printf (const char* format, ...)
+{
+	check ("printf");
+	va_list args;
+	va_start (args, format);
+	const int result = next (nextVfprintf, "vfprintf") (stdout, format, args);
+	va_end (args);
+	return result;
+}
+
+// Fortified variants used by plugins built with _FORTIFY_SOURCE
+int __fprintf_chk (FILE* stream, int flag, const char* format, ...)
+{
+	check ("fprintf");
+	va_list args;
+	va_start (args, format);
+	const int result = next (nextVfprintf, "vfprintf") (stream, format, args);
+	va_end (args);
+	return result;
+}
+
+int __printf_chk (int flag, const char* format, ...)
+{
+	check ("printf");
+	va_list args;
+	va_start (args, format);
+	const int result = next (nextVfprintf, "vfprintf") (stdout, format, args);
+	va_end (args);
+	return result;
+}
+
+int __vfprintf_chk (FILE* stream, int flag, const char* format, va_list args)
+{
+	check ("vfprintf");
+	return next (nextVfprintf, "vfprintf") (stream, format, args);
+}
+
+int open (const char* path, int flags, ...)
+{
+	check ("open");
+	va_list args;
+	va_start (args, flags);
+	const mode_t mode = va_arg (args, mode_t);
+	va_end (args);
+	return next (nextOpen, "open") (path, flags, mode);
+}
+
+int open64 (const char* path, int flags, ...)
+{
+	check ("open64");
+	va_list args;
+	va_start (args, flags);
+	const mode_t mode = va_arg (args, mode_t);
+	va_end (args);
+	return next (nextOpen64, "open64") (path, flags, mode);
+}
+
+int openat (int dirfd, const char* path, int flags, ...)
+{
+	check ("openat");
+	va_list args;
+	va_start (args, flags);
+	const mode_t mode = va_arg (args, mode_t);
+	va_end (args);
+	return next (nextOpenat, "openat") (dirfd, path, flags, mode);
+}
+
+int close (int fd)
+{
+	check ("close");
+	return next (nextClose, "close") (fd);
+}
+
+ssize_t read (int fd, void* buf, size_t count)
+{
+	check ("read");
+	return next (nextRead, "read") (fd, buf, count);
+}
+
+ssize_t __read_chk (int fd, void* buf, size_t count, size_t buflen)
+{
+	check ("read");
+	return next (nextRead, "read") (fd, buf, count);
+}
+
+ssize_t write (int fd, const void* buf, size_t count)
+{
+	check ("write");
+	return next (nextWrite, "write") (fd, buf, count);
+}
+}
+
+/*
+ * Headless plugin session: Port buffers, a control port forge and the
+ * checked run cycle.
+ */
+class Session
+{
+public:
+	Session (TestHost& host, const LV2_Descriptor* descriptor, LV2_Handle instance) :
+		uris (), host (host), descriptor (descriptor), instance (instance), forge (), frame (),
+		control (CONTROL_SIZE / sizeof (uint64_t), 0), notify (NOTIFY_SIZE / sizeof (uint64_t), 0),
+		controllers {0}, freewheel (0.0f), performance {0}, audio (4 * BLOCK_LENGTH, 0.0f), time (0)
+	{
+		getURIs (host.getMap (), &uris);
+		lv2_atom_forge_init (&forge, host.getMap ());
+
+		// Defaults, MIDI page triggers off
+		controllers[PLAY] = 1.0f;
+		controllers[NR_OF_STEPS] = 16.0f;
+		controllers[STEP_BASE] = SECONDS;
+		controllers[STEP_SIZE] = 0.01f;
+		controllers[SPEED] = 1.0f;
+		for (int p = 0; p < MAXPAGES; ++p)
+		{
+			controllers[MIDI + p * NR_MIDI_CTRLS + NOTE] = 128.0f;
+			controllers[MIDI + p * NR_MIDI_CTRLS + VALUE] = 128.0f;
+		}
+
+		descriptor->connect_port (instance, CONTROL, control.data ());
+		descriptor->connect_port (instance, NOTIFY, notify.data ());
+		for (int c = 0; c < 2; ++c)
+		{
+			descriptor->connect_port (instance, getAudioInPort (2, c), &audio[c * BLOCK_LENGTH]);
+			descriptor->connect_port (instance, getAudioOutPort (2, c), &audio[(2 + c) * BLOCK_LENGTH]);
+		}
+		for (int i = 0; i < MAXCONTROLLERS; ++i) descriptor->connect_port (instance, getControllersPort (2) + i, &controllers[i]);
+		descriptor->connect_port (instance, getFreewheelPort (2), &freewheel);
+		for (int i = 0; i < NR_PERFORMANCE_PORTS; ++i) descriptor->connect_port (instance, getPerformancePort (2) + i, &performance[i]);
+
+		beginControl ();
+	}
+
+	/*
+	 * Runs nr cycles. Events added to the control port since the last
+	 * call are sent with the first cycle.
+	 */
+	void run (const char* step, const int nr)
+	{
+		currentStep = step;
+		for (int i = 0; i < nr; ++i)
+		{
+			// Input signal
+			for (int j = 0; j < BLOCK_LENGTH; ++j)
+			{
+				const float v = 0.5f * sinf (float (time + j) * 0.0625f);
+				audio[j] = v;
+				audio[BLOCK_LENGTH + j] = -v;
+			}
+			time += BLOCK_LENGTH;
+
+			lv2_atom_forge_pop (&forge, &frame);
+			LV2_Atom_Sequence* notifySequence = (LV2_Atom_Sequence*) notify.data ();
+			notifySequence->atom.size = NOTIFY_SIZE - sizeof (LV2_Atom);
+
+			rtContext.store (true);
+			descriptor->run (instance, BLOCK_LENGTH);
+			rtContext.store (false);
+
+			host.work (descriptor, instance);
+
+			rtContext.store (true);
+			host.deliverResponses (descriptor, instance);
+			rtContext.store (false);
+
+			beginControl ();
+		}
+		currentStep = "";
+	}
+
+	void setController (const int index, const float value) {controllers[index] = value;}
+
+	void sendUiOn ()
+	{
+		LV2_Atom_Forge_Frame objectFrame;
+		lv2_atom_forge_frame_time (&forge, 0);
+		lv2_atom_forge_object (&forge, &objectFrame, 0, uris.ui_on);
+		lv2_atom_forge_pop (&forge, &objectFrame);
+	}
+
+	void sendPads (const int page, const std::vector<PadMessage>& pads)
+	{
+		LV2_Atom_Forge_Frame objectFrame;
+		lv2_atom_forge_frame_time (&forge, 0);
+		lv2_atom_forge_object (&forge, &objectFrame, 0, uris.notify_padEvent);
+		lv2_atom_forge_key (&forge, uris.notify_padPage);
+		lv2_atom_forge_int (&forge, page);
+		lv2_atom_forge_key (&forge, uris.notify_pad);
+		lv2_atom_forge_vector (&forge, sizeof (float), uris.atom_Float, pads.size () * sizeof (PadMessage) / sizeof (float), pads.data ());
+		lv2_atom_forge_pop (&forge, &objectFrame);
+	}
+
+	void sendFullPattern (const int page, const float level)
+	{
+		std::vector<Pad> pattern (MAXSTEPS * MAXSTEPS, Pad (0.0f));
+		for (int s = 0; s < MAXSTEPS; ++s) pattern[((s + page) % MAXSTEPS) * MAXSTEPS + s] = Pad (level);
+
+		LV2_Atom_Forge_Frame objectFrame;
+		lv2_atom_forge_frame_time (&forge, 0);
+		lv2_atom_forge_object (&forge, &objectFrame, 0, uris.notify_padEvent);
+		lv2_atom_forge_key (&forge, uris.notify_padPage);
+		lv2_atom_forge_int (&forge, page);
+		lv2_atom_forge_key (&forge, uris.notify_padFullPattern);
+		lv2_atom_forge_vector (&forge, sizeof (float), uris.atom_Float, pattern.size () * sizeof (Pad) / sizeof (float), pattern.data ());
+		lv2_atom_forge_pop (&forge, &objectFrame);
+	}
+
+	void sendStatusInt (const LV2_URID key, const int32_t value)
+	{
+		LV2_Atom_Forge_Frame objectFrame;
+		lv2_atom_forge_frame_time (&forge, 0);
+		lv2_atom_forge_object (&forge, &objectFrame, 0, uris.notify_statusEvent);
+		lv2_atom_forge_key (&forge, key);
+		lv2_atom_forge_int (&forge, value);
+		lv2_atom_forge_pop (&forge, &objectFrame);
+	}
+
+	void sendStatusBool (const LV2_URID key, const bool value)
+	{
+		LV2_Atom_Forge_Frame objectFrame;
+		lv2_atom_forge_frame_time (&forge, 0);
+		lv2_atom_forge_object (&forge, &objectFrame, 0, uris.notify_statusEvent);
+		lv2_atom_forge_key (&forge, key);
+		lv2_atom_forge_bool (&forge, value);
+		lv2_atom_forge_pop (&forge, &objectFrame);
+	}
+
+	void sendSamplePath (const char* path, const bool loop)
+	{
+		LV2_Atom_Forge_Frame objectFrame;
+		lv2_atom_forge_frame_time (&forge, 0);
+		lv2_atom_forge_object (&forge, &objectFrame, 0, uris.notify_pathEvent);
+		lv2_atom_forge_key (&forge, uris.notify_samplePath);
+		lv2_atom_forge_path (&forge, path, strlen (path) + 1);
+		lv2_atom_forge_key (&forge, uris.notify_sampleStart);
+		lv2_atom_forge_long (&forge, 0);
+		lv2_atom_forge_key (&forge, uris.notify_sampleEnd);
+		lv2_atom_forge_long (&forge, INT32_MAX);
+		lv2_atom_forge_key (&forge, uris.notify_sampleAmp);
+		lv2_atom_forge_float (&forge, 0.8f);
+		lv2_atom_forge_key (&forge, uris.notify_sampleLoop);
+		lv2_atom_forge_bool (&forge, loop);
+		lv2_atom_forge_pop (&forge, &objectFrame);
+	}
+
+	void sendMidi (const int64_t frames, const uint8_t status, const uint8_t note, const uint8_t value)
+	{
+		const uint8_t msg[3] = {status, note, value};
+		lv2_atom_forge_frame_time (&forge, frames);
+		lv2_atom_forge_atom (&forge, sizeof (msg), uris.midi_Event);
+		lv2_atom_forge_write (&forge, msg, sizeof (msg));
+	}
+
+	BJumblrURIs uris;
+
+private:
+	void beginControl ()
+	{
+		lv2_atom_forge_set_buffer (&forge, (uint8_t*) control.data (), CONTROL_SIZE);
+		lv2_atom_forge_sequence_head (&forge, &frame, 0);
+	}
+
+	TestHost& host;
+	const LV2_Descriptor* descriptor;
+	LV2_Handle instance;
+	LV2_Atom_Forge forge;
+	LV2_Atom_Forge_Frame frame;
+	std::vector<uint64_t> control;
+	std::vector<uint64_t> notify;
+	float controllers[MAXCONTROLLERS];
+	float freewheel;
+	float performance[NR_PERFORMANCE_PORTS];
+	std::vector<float> audio;
+	int64_t time;
+};
+
+/*
+ * Writes a mono 16 bit PCM WAV file with a sine of nrFrames frames.
+ * @return		True on success
+ */
+static bool writeWav (const char* path, const int nrFrames, const float frequency)
+{
+	FILE* f = fopen (path, "wb");
+	if (!f) return false;
+
+	const uint32_t rate = 48000;
+	const uint32_t dataSize = nrFrames * sizeof (int16_t);
+	const uint32_t riffSize = 36 + dataSize;
+	const uint32_t fmtSize = 16;
+	const uint16_t format = 1;
+	const uint16_t channels = 1;
+	const uint32_t byteRate = rate * sizeof (int16_t);
+	const uint16_t blockAlign = sizeof (int16_t);
+	const uint16_t bits = 16;
+
+	fwrite ("RIFF", 1, 4, f);
+	fwrite (&riffSize, 4, 1, f);
+	fwrite ("WAVEfmt ", 1, 8, f);
+	fwrite (&fmtSize, 4, 1, f);
+	fwrite (&format, 2, 1, f);
+	fwrite (&channels, 2, 1, f);
+	fwrite (&rate, 4, 1, f);
+	fwrite (&byteRate, 4, 1, f);
+	fwrite (&blockAlign, 2, 1, f);
+	fwrite (&bits, 2, 1, f);
+	fwrite ("data", 1, 4, f);
+	fwrite (&dataSize, 4, 1, f);
+	for (int i = 0; i < nrFrames; ++i)
+	{
+		const int16_t v = int16_t (16000.0f * sinf (2.0f * float (M_PI) * frequency * float (i) / float (rate)));
+		fwrite (&v, 2, 1, f);
+	}
+
+	fclose (f);
+	return true;
+}
+
+int main (int argc, char** argv)
+{
+	resolveNext ();
+
+	const char* pluginPath = (argc > 1 ? argv[1] : "BJumblr.lv2/BJumblr.so");
+	TestHost host (BLOCK_LENGTH);
+	if (!host.load (pluginPath)) return 1;
+
+	const LV2_Descriptor* descriptor = host.getDescriptor (BJUMBLR_URI);
+	if (!descriptor) return 1;
+
+	LV2_Handle instance = host.instantiate (descriptor, 48000.0);
+	if (!instance) return 1;
+
+	const char* samplePaths[2] = {"/tmp/test_rtsafety_1.wav", "/tmp/test_rtsafety_2.wav"};
+	if (!writeWav (samplePaths[0], 48000, 440.0f) || !writeWav (samplePaths[1], 24000, 660.0f))
+	{
+		fprintf (stderr, "Can't write test samples to /tmp.\n");
+		return 1;
+	}
+
+	{
+		Session session (host, descriptor, instance);
+		const BJumblrURIs& uris = session.uris;
+		if (descriptor->activate) descriptor->activate (instance);
+
+		session.run ("idle", 16);
+
+		session.sendUiOn ();
+		session.run ("ui on", 16);
+
+		// Pattern edits on several pages
+		session.sendStatusInt (uris.notify_maxPage, 4);
+		for (int p = 0; p < 4; ++p) session.sendFullPattern (p, 1.0f);
+		session.run ("full pattern", 16);
+		std::vector<PadMessage> pads;
+		for (int s = 0; s < MAXSTEPS; ++s) pads.push_back (PadMessage (s, (s * 3) % MAXSTEPS, 0.5f));
+		session.sendPads (1, pads);
+		session.run ("pad edit", 16);
+
+		// Page switches by the PAGE controller, by the GUI and by MIDI
+		for (int p = 0; p < 4; ++p)
+		{
+			session.setController (PAGE, p);
+			session.run ("page switch", 16);
+		}
+		session.sendStatusInt (uris.notify_playbackPage, 2);
+		session.run ("playback page", 16);
+		session.setController (MIDI + 3 * NR_MIDI_CTRLS + STATUS, 9);
+		session.setController (MIDI + 3 * NR_MIDI_CTRLS + NOTE, 60);
+		session.run ("MIDI page table", 4);
+		session.sendMidi (10, 0x90, 60, 100);
+		session.sendMidi (200, 0x80, 60, 0);
+		session.run ("MIDI page switch", 16);
+
+		// MIDI learn
+		session.sendStatusBool (uris.notify_requestMidiLearn, true);
+		session.run ("MIDI learn request", 4);
+		session.sendMidi (0, 0xB1, 7, 64);
+		session.run ("MIDI learn", 16);
+
+		// Sample hot-swap
+		session.setController (SOURCE, 1.0f);
+		session.sendSamplePath (samplePaths[0], true);
+		session.run ("sample load", 32);
+		session.sendSamplePath (samplePaths[1], false);
+		session.run ("sample swap", 32);
+		session.sendSamplePath ("/tmp/test_rtsafety_missing.wav", false);
+		session.run ("sample swap (invalid)", 32);
+		session.sendSamplePath (samplePaths[0], true);
+		session.run ("sample swap", 32);
+
+		// State save, change, restore
+		if (host.saveState (descriptor, instance) != LV2_STATE_SUCCESS) fprintf (stderr, "state_save () failed.\n");
+		session.sendFullPattern (0, 0.0f);
+		session.sendSamplePath (samplePaths[1], false);
+		session.run ("pattern change", 16);
+		if (host.restoreState (descriptor, instance) != LV2_STATE_SUCCESS) fprintf (stderr, "state_restore () failed.\n");
+		session.run ("state restore", 32);
+
+		// History resize
+		session.setController (SOURCE, 0.0f);
+		session.setController (NR_OF_STEPS, 32.0f);
+		session.setController (STEP_SIZE, 1.0f);
+		session.run ("history resize", 64);
+
+		// History shrink after HISTORY_SHRINK_TIME (10 s)
+		session.setController (NR_OF_STEPS, 2.0f);
+		session.setController (STEP_SIZE, 0.01f);
+		session.run ("history shrink", 12 * 48000 / BLOCK_LENGTH);
+
+		if (descriptor->deactivate) descriptor->deactivate (instance);
+	}
+
+	descriptor->cleanup (instance);
+	remove (samplePaths[0]);
+	remove (samplePaths[1]);
+
+	if (nrViolations)
+	{
+		fprintf (stderr, "%i non-realtime-safe calls from run () or work_response ():\n", nrViolations);
+		for (int i = 0; i < nrDistinctViolations; ++i) fprintf (stderr, "  %s: %s\n", violations[i].step, violations[i].function);
+		return 1;
+	}
+
+	printf ("No non-realtime-safe calls from run () or work_response ().\n");
+	return 0;
+}
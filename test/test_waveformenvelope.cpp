@@ -0,0 +1,181 @@
+/* B.Jumblr
+ * Pattern-controlled audio stream / sample re-sequencer LV2 plugin
+ *
+ * Copyright (C) 2018 - 2020 by Sven Jähnichen
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks the waveform envelope transport: 8 and 16 bit round trips keep
+ * the envelope within one quantization step and never hide peaks, ranges
+ * wrapping around the end of the ring only touch their slots, silence
+ * stays silent and invalid chunks are rejected.
+ */
+
+#include <cstdio>
+#include <vector>
+#include <random>
+#include "WaveformEnvelope.hpp"
+
+static int checks = 0;
+static int failed = 0;
+
+static void check (const bool condition, const char* name, const int bits)
+{
+	++checks;
+	if (!condition)
+	{
+		fprintf (stderr, "%s (%i bit) failed\n", name, bits);
+		++failed;
+	}
+}
+
+static void fillRandom (std::mt19937& rnd, EnvelopeSlot* slots, const float amp)
+{
+	std::uniform_real_distribution<float> dist (-amp, amp);
+	for (int i = 0; i < WAVEFORMSIZE; ++i)
+	{
+		const float a = dist (rnd);
+		const float b = dist (rnd);
+		slots[i] = EnvelopeSlot {std::min (a, b), std::max (a, b)};
+	}
+}
+
+/*
+ * Encodes and decodes size slots starting at start. Checks the decoded
+ * range against the source and that all other slots are untouched.
+ */
+static void checkRoundTrip (const char* name, const EnvelopeSlot* source, const int start, const int size, const int bits)
+{
+	const float sentinel = 1000.0f;
+	std::vector<uint8_t> chunk (getWaveformEnvelopeSize (size, bits));
+	std::vector<EnvelopeSlot> decoded (WAVEFORMSIZE, EnvelopeSlot {sentinel, sentinel});
+	int dStart = -1;
+	int dSize = -1;
+
+	encodeWaveformEnvelope (source, start, size, bits, chunk.data ());
+	const bool valid = decodeWaveformEnvelope (chunk.data (), chunk.size (), decoded.data (), dStart, dSize);
+	check (valid && (dStart == start) && (dSize == size), name, bits);
+	if (!valid) return;
+
+	WaveformEnvelopeHeader header;
+	memcpy (&header, chunk.data (), sizeof (header));
+	const float step = header.scale / (bits == 16 ? 32767.0f : 127.0f);
+	const float tolerance = 1e-6f * std::max (header.scale, 1.0f);
+
+	bool inRange = true;
+	bool untouched = true;
+	for (int i = 0; i < WAVEFORMSIZE; ++i)
+	{
+		const bool encoded = ((i - start + WAVEFORMSIZE) % WAVEFORMSIZE) < size;
+		const EnvelopeSlot& s = source[i];
+		const EnvelopeSlot& d = decoded[i];
+		if (encoded)
+		{
+			// Min rounded down, max rounded up, by less than one step
+			if ((d.min > s.min + tolerance) || (d.min < s.min - step - tolerance)) inRange = false;
+			if ((d.max < s.max - tolerance) || (d.max > s.max + step + tolerance)) inRange = false;
+			if ((d.min < -header.scale - tolerance) || (d.max > header.scale + tolerance)) inRange = false;
+		}
+		else if ((d.min != sentinel) || (d.max != sentinel)) untouched = false;
+	}
+	check (inRange, name, bits);
+	check (untouched, name, bits);
+}
+
+int main ()
+{
+	std::mt19937 rnd (1);
+	std::vector<EnvelopeSlot> slots (WAVEFORMSIZE);
+	const int bits[2] = {8, 16};
+
+	for (const int b : bits)
+	{
+		// Round trips
+		fillRandom (rnd, slots.data (), 1.0f);
+		checkRoundTrip ("full ring", slots.data (), 0, WAVEFORMSIZE, b);
+		checkRoundTrip ("single slot", slots.data (), 17, 1, b);
+		fillRandom (rnd, slots.data (), 0.001f);
+		checkRoundTrip ("quiet signal", slots.data (), 0, WAVEFORMSIZE, b);
+		fillRandom (rnd, slots.data (), 8.0f);
+		checkRoundTrip ("loud signal", slots.data (), 100, 500, b);
+
+		// Ranges wrapping around the end of the ring
+		fillRandom (rnd, slots.data (), 1.0f);
+		checkRoundTrip ("wrap-around", slots.data (), 1000, 50, b);
+		checkRoundTrip ("wrap-around from last slot", slots.data (), WAVEFORMSIZE - 1, 2, b);
+		checkRoundTrip ("full ring from middle", slots.data (), 512, WAVEFORMSIZE, b);
+
+		// Peaks are kept
+		{
+			std::vector<EnvelopeSlot> peaks (WAVEFORMSIZE, EnvelopeSlot {0.0f, 0.0f});
+			peaks[3] = EnvelopeSlot {-0.3f, 0.7f};
+			peaks[4] = EnvelopeSlot {-0.0001f, 0.0001f};
+			std::vector<uint8_t> chunk (getWaveformEnvelopeSize (8, b));
+			std::vector<EnvelopeSlot> decoded (WAVEFORMSIZE);
+			int start, size;
+			encodeWaveformEnvelope (peaks.data (), 0, 8, b, chunk.data ());
+			decodeWaveformEnvelope (chunk.data (), chunk.size (), decoded.data (), start, size);
+			check ((decoded[3].max >= 0.7f - 1e-6f) && (decoded[3].min <= -0.3f + 1e-6f), "peak", b);
+			check ((decoded[4].max > 0.0f) && (decoded[4].min < 0.0f), "small peak", b);
+			check ((decoded[0].max == 0.0f) && (decoded[0].min == 0.0f), "zero slot", b);
+		}
+
+		// Silence
+		{
+			std::vector<EnvelopeSlot> silence (WAVEFORMSIZE, EnvelopeSlot {0.0f, 0.0f});
+			std::vector<uint8_t> chunk (getWaveformEnvelopeSize (WAVEFORMSIZE, b));
+			std::vector<EnvelopeSlot> decoded (WAVEFORMSIZE, EnvelopeSlot {1.0f, 1.0f});
+			int start, size;
+			encodeWaveformEnvelope (silence.data (), 0, WAVEFORMSIZE, b, chunk.data ());
+			const bool valid = decodeWaveformEnvelope (chunk.data (), chunk.size (), decoded.data (), start, size);
+			bool silent = true;
+			for (const EnvelopeSlot& s : decoded) silent = silent && (s.min == 0.0f) && (s.max == 0.0f);
+			check (valid && silent, "silence", b);
+		}
+
+		// Invalid chunks
+		{
+			std::vector<uint8_t> chunk (getWaveformEnvelopeSize (50, b));
+			std::vector<EnvelopeSlot> decoded (WAVEFORMSIZE);
+			int start, size;
+			WaveformEnvelopeHeader header;
+			encodeWaveformEnvelope (slots.data (), 1000, 50, b, chunk.data ());
+
+			check (!decodeWaveformEnvelope (chunk.data (), sizeof (header) - 1, decoded.data (), start, size), "truncated header", b);
+			check (!decodeWaveformEnvelope (chunk.data (), chunk.size () - 1, decoded.data (), start, size), "truncated data", b);
+
+			std::vector<uint8_t> invalid = chunk;
+			memcpy (&header, chunk.data (), sizeof (header));
+			header.bits = 12;
+			memcpy (invalid.data (), &header, sizeof (header));
+			check (!decodeWaveformEnvelope (invalid.data (), invalid.size (), decoded.data (), start, size), "invalid bits", b);
+
+			memcpy (&header, chunk.data (), sizeof (header));
+			header.start = WAVEFORMSIZE;
+			memcpy (invalid.data (), &header, sizeof (header));
+			check (!decodeWaveformEnvelope (invalid.data (), invalid.size (), decoded.data (), start, size), "invalid start", b);
+
+			memcpy (&header, chunk.data (), sizeof (header));
+			header.size = WAVEFORMSIZE + 1;
+			memcpy (invalid.data (), &header, sizeof (header));
+			check (!decodeWaveformEnvelope (invalid.data (), invalid.size (), decoded.data (), start, size), "invalid size", b);
+		}
+	}
+
+	printf ("Waveform envelope: %i checks, %i failed\n", checks, failed);
+	return (failed ? 1 : 0);
+}
@@ -0,0 +1,127 @@
+# B.Jumblr
+# Generates the TTL of a channel variant from BJumblr.ttl (stereo). Usage:
+#
+#	awk -v fragment=ttl/BJumblrMono.ttl.in -f ttl/variant.awk BJumblr.ttl
+#
+# The fragment contains everything that differs from the stereo plugin:
+# Additional @prefix lines, definitions (e.g. port groups) followed by the
+# plugin subject line, plugin properties (doap:name replaces the stereo
+# name, all other properties are added before lv2:port), and after a line
+# "#audio ports" the audio port blocks. The stereo definitions (author,
+# parameters, GUI) are left out, they are found in BJumblr.ttl by
+# rdfs:seeAlso. The stereo audio ports are replaced by the fragment audio
+# ports and the indices of all following ports are shifted by the
+# difference in the number of audio ports.
+
+function isAudio(block)
+{
+	return (block ~ /lv2:AudioPort/)
+}
+
+function shiftIndex(line,    nr)
+{
+	if (!match (line, /lv2:index [0-9]+/)) return line
+	nr = substr (line, RSTART + 10, RLENGTH - 10) + offset
+	return substr (line, 1, RSTART - 1) "lv2:index " nr substr (line, RSTART + RLENGTH)
+}
+
+BEGIN {
+	nrPrefixes = 0; nrHead = 0; nrProperties = 0; nrAudio = 0; name = ""
+	section = "head"
+	while ((getline line < fragment) > 0)
+	{
+		if (line == "#audio ports") section = "audio"
+		else if (line ~ /^#/) continue
+		else if ((line == "") && (nrHead == 0)) continue
+		else if (section == "audio")
+		{
+			audio[++nrAudio] = line
+			if (line ~ /lv2:AudioPort/) ++fragmentAudioPorts
+		}
+		else if (line ~ /^@prefix/) prefixes[++nrPrefixes] = line
+		else if (line ~ /^</)
+		{
+			# Only the last subject is the plugin, all before are definitions
+			for (i = 1; i <= nrProperties; ++i) head[++nrHead] = properties[i]
+			head[++nrHead] = line
+			nrProperties = 0
+			section = "properties"
+		}
+		else if (section == "properties")
+		{
+			if (line ~ /doap:name/) name = line
+			else properties[++nrProperties] = line
+		}
+		else head[++nrHead] = line
+	}
+	close (fragment)
+	if ((nrAudio == 0) || (name == ""))
+	{
+		print "variant.awk: Missing audio ports or doap:name in " fragment > "/dev/stderr"
+		exit 1
+	}
+
+	while ((getline line < ARGV[1]) > 0) if (line ~ /lv2:AudioPort/) ++stereoAudioPorts
+	close (ARGV[1])
+	offset = fragmentAudioPorts - stereoAudioPorts
+
+	state = "prefixes"
+	block = ""
+	audioDone = 0
+}
+
+# Prefixes, followed by the additional prefixes
+state == "prefixes" {
+	if ($0 ~ /^@prefix/) {print; next}
+	for (i = 1; i <= nrPrefixes; ++i) print prefixes[i]
+	print
+	state = "definitions"
+	next
+}
+
+# Stereo definitions and plugin subject, replaced by the fragment head
+state == "definitions" {
+	if ($0 !~ /^<https:\/\/www\.jahnichen\.de\/plugins\/lv2\/BJumblr>/) next
+	for (i = 1; i <= nrHead; ++i) print head[i]
+	state = "plugin"
+	next
+}
+
+state == "plugin" {
+	if ($0 ~ /doap:name/) {print name; next}
+	if ($0 ~ /lv2:port \[/)
+	{
+		for (i = 1; i <= nrProperties; ++i) print properties[i]
+		print
+		state = "ports"
+		next
+	}
+	print
+	next
+}
+
+# Port blocks, each closed by a "] , [" separator or the closing "] ;"
+state == "ports" {
+	if (($0 !~ /^[ \t]*\] , \[[ \t]*$/) && ($0 !~ /^[ \t]*\] ;[ \t]*$/))
+	{
+		block = block $0 "\n"
+		next
+	}
+
+	if (isAudio(block))
+	{
+		if (!audioDone) {for (i = 1; i <= nrAudio; ++i) print audio[i]; print}
+		audioDone = 1
+	}
+	else
+	{
+		n = split (block, lines, "\n")
+		for (i = 1; i < n; ++i) print (audioDone ? shiftIndex(lines[i]) : lines[i])
+		print
+	}
+	block = ""
+	if ($0 ~ /\] ;/) state = "rest"
+	next
+}
+
+{print}